@@ -50,9 +50,9 @@ class Activities
     bool   auto_resume_enabled = true;
     size_t selected_index = 0;
 
-    std::vector<Rom>&                       roms_list = Rom::get();
-    std::vector<std::vector<Rom>::iterator> filtered_roms_list;
-    size_t                                  list_size = 0;
+    RomTable&              roms_list = Rom::get();
+    std::vector<RomHandle> filtered_roms_list;
+    size_t                 list_size = 0;
 
     size_t        total_time = 0;
     FiltersStates filters_states = {FilterState::All};
@@ -63,6 +63,11 @@ class Activities
     std::vector<std::string> systems;
     size_t                   system_index = 0;
 
+    // Statistics from DB of the rom shown in details (latencies, activity, resources), loaded once
+    // per rom
+    std::string                                      stats_file;
+    std::vector<std::pair<std::string, std::string>> stats_details;
+
     // Auto-scroll (key repeat) management for Up/Down in the list
     bool upHolding = false;   // true while UP is held
     bool downHolding = false; // true while DOWN is held
@@ -82,18 +87,27 @@ class Activities
 
     Rom* get_rom(const std::string& rom_file = "");
 
-    void sort_roms();
-    void filter_roms();
+    uint16_t current_system_id() const;
+    bool     matches_filters(RomTable::Row row, uint16_t system_id) const;
+    bool     rom_less(RomTable::Row a, RomTable::Row b) const;
+    void     sort_roms();
+    void     filter_roms();
+    void     update_filtered(RomHandle rom);
 
     MenuResult switch_filter(const std::string& label, int& state);
     MenuResult sort_menu();
     MenuResult filters_menu();
     void       global_menu();
-    void       game_menu(std::vector<Rom>::iterator rom);
+    void       game_menu(Rom rom);
 
     void start_external(const std::string& command);
     void game_list();
     void game_detail();
+    void load_stats_details(Rom rom);
+    void load_latency_details(Rom rom);
+    void load_activity_details(Rom rom);
+    void load_profile_details(Rom rom);
+    int  live_time(Rom rom) const;
     void overall_stats();
     void empty_db();
 
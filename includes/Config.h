@@ -53,7 +53,10 @@ class Config
     Config(const Config& copy);
     Config& operator=(const Config& copy);
 
+    std::unordered_map<std::string, std::string> settings;
+
     bool      load_theme(const std::string& filePath);
+    void      load_settings();
     SDL_Color parseColor(const std::string& colorStr) const;
 
   public:
@@ -77,4 +80,51 @@ class Config
 
     std::string theme_path = "";
     Theme       theme;
+
+    // Destroy the renderer too while a game runs, not only the textures.
+    bool background_release_renderer = false;
+    // Texture memory kept for rendered texts, the least recently drawn destroyed beyond it, 0 for
+    // no limit.
+    int text_cache_budget_mb = 8;
+    // Auto-resume: games loading at once, give up delay and CPU use (% of a core) once loaded.
+    int resume_parallelism = 2;
+    int resume_timeout_ms = 8000;
+    int resume_settle_percent = 30;
+    // Resident memory allowed to suspended games before saving and closing the oldest, 0 for no
+    // limit. They are closed through the RetroArch network commands port.
+    int suspended_memory_budget_mb = 0;
+    int retroarch_cmd_port = 55355;
+    // Page out the memory of games once suspended (to zram or swap).
+    bool suspend_pageout = false;
+    // Run each game in its own cgroup (v2) under `cgroup_root`, frozen while suspended.
+    bool        use_cgroups = true;
+    std::string cgroup_root = "/sys/fs/cgroup";
+    // Launch games with posix_spawn rather than fork, nice value and cpus ("2-3") given to them,
+    // overridden per system by game_nice.<system> and game_cpus.<system>.
+    bool        use_posix_spawn = true;
+    int         game_nice = 0;
+    std::string game_cpus = "";
+    // Nice value and cpus of the GUI while a game is in front, commands of the game processes
+    // moved to SCHED_BATCH (launch scripts, input daemons).
+    int         gui_nice = 10;
+    std::string gui_cpus = "";
+    std::string helper_processes = "sh,bash,ash,busybox";
+    // Read the selected rom into the page cache once selected for that long, 0 MB to disable.
+    int readahead_dwell_ms = 500;
+    int readahead_budget_mb = 256;
+    // Give up measuring the time to the first frame of a game after that long, 0 to disable.
+    int latency_timeout_ms = 30000;
+    // Checkpoint the sessions in progress to the journal that often, 0 to disable.
+    int checkpoint_minutes = 5;
+    // Count time as idle after that long without gamepad input, or while the game uses less CPU
+    // than that percent of a core, 0 s to disable.
+    int idle_timeout_s = 0;
+    int idle_cpu_percent = 10;
+    // sysfs trees used by the cpu_profile.<system> settings and their battery log
+    std::string cpufreq_root = "/sys/devices/system/cpu";
+    std::string battery_path = "/sys/class/power_supply/axp2202-battery";
+
+    std::string get_setting(const std::string& key, const std::string& fallback = "") const;
+    int         get_int_setting(const std::string& key, int fallback) const;
+    bool        get_bool_setting(const std::string& key, bool fallback) const;
 };
@@ -5,6 +5,8 @@
 #include <vector>
 
 #define DB_FILE APP_DIR "data/games.db"
+// Longest wait for a lock held by the other process (GUI or timer daemon) before failing.
+#define DB_BUSY_TIMEOUT_MS 2000
 
 class Rom;
 
@@ -20,6 +22,23 @@ struct DB_row
     int         favorite;
 };
 
+// Resources used by the game over a session, -1 when unknown.
+struct SessionProfile
+{
+    int       cpu_percent; // of one core, while running
+    long      peak_rss_kb; // of the game process so far
+    long long read_kb;     // from storage
+};
+
+// Averages of the sessions of a game or system with a profile.
+struct ProfileStats
+{
+    int       sessions;
+    int       cpu_percent; // weighted by the session times
+    long      peak_rss_kb; // the highest
+    long long read_kb;     // per session
+};
+
 class DB
 {
   private:
@@ -46,4 +65,17 @@ class DB
     DB_row              load(const std::string& file);
 
     void remove(const std::string& file);
+    bool begin();
+    bool commit();
+
+    void save_latency(const std::string& file, const std::string& system, bool resume, int ms);
+    std::vector<int> load_latencies(
+        const std::string& system, bool resume, const std::string& file = "");
+
+    void save_activity(const std::string& file, int active, int idle);
+    bool load_activity(const std::string& file, int& active, int& idle);
+
+    void save_profile(const std::string& file, const std::string& system, int time,
+        const SessionProfile& profile);
+    ProfileStats load_profile_stats(const std::string& system, const std::string& file = "");
 };
@@ -6,6 +6,7 @@
 #include <SDL_image.h>
 #include <SDL_ttf.h>
 #include <functional>
+#include <list>
 #include <string>
 #include <sys/stat.h>
 #include <sys/wait.h>
@@ -105,12 +106,26 @@ struct Text
     };
 };
 
+// Hash of a Text, the key of the text cache.
+struct TextHash
+{
+    size_t operator()(const Text& text) const
+    {
+        uint32_t color = static_cast<uint32_t>(text.color.r) << 24 | text.color.g << 16 |
+                         text.color.b << 8 | text.color.a;
+        uint64_t style = static_cast<uint64_t>(text.size) << 32 | color;
+        size_t   hash = std::hash<std::string>()(text.str);
+        return hash ^ (std::hash<uint64_t>()(style) + 0x9e3779b9 + (hash << 6) + (hash >> 2));
+    }
+};
+
 struct CachedText
 {
     SDL_Texture* texture = nullptr;
     int          width = 0;
     int          height = 0;
     Text         text;
+    unsigned     last_frame = 0; // last frame the text was drawn in
 };
 
 struct CachedImg
@@ -118,6 +133,7 @@ struct CachedImg
     SDL_Texture* texture = nullptr;
     int          width = 0;
     int          height = 0;
+    unsigned     last_frame = 0; // last frame the image was drawn in
 };
 
 typedef std::vector<std::pair<std::string, SDL_Color>> vecColorString;
@@ -137,10 +153,23 @@ class GUI
 
     std::map<int, TTF_Font*> fonts;
 
-    std::vector<CachedText>                    cached_text;
-    std::unordered_map<std::string, CachedImg> image_cache;
+    // Text textures, the most recently drawn first. List nodes never move, so the references
+    // handed out stay valid until evicted, and the index keeps iterators into the list.
+    std::list<CachedText>                                                text_lru;
+    std::unordered_map<Text, std::list<CachedText>::iterator, TextHash> text_index;
+    size_t                                                               text_bytes = 0;
+    unsigned long                                                        text_hits = 0;
+    unsigned long                                                        text_misses = 0;
+    std::unordered_map<std::string, CachedImg>                           image_cache;
 
     CachedText& getCachedText(const Text& text);
+    void        evict_texts();
+    CachedImg&  load_image(const std::string& image_path);
+
+    // Background mode: GPU resources are released while a game is in the foreground.
+    bool                     in_background = false;
+    unsigned                 frame = 0;
+    std::vector<std::string> restore_images; // images of the last frame, reloaded on return
 
     bool         scroll_reset = false;
     SDL_Texture* background_texture = nullptr;
@@ -169,6 +198,11 @@ class GUI
 
     void clean();
 
+    std::string joystick_name() const;
+
+    size_t enter_background();
+    void   leave_background();
+
     int init();
 
     int Width;
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#define JOURNAL_FILE APP_DIR "data/sessions.journal"
+#define JOURNAL_SLOTS 8
+
+// One session in progress. The whole journal fits in a single page.
+struct JournalSlot
+{
+    uint32_t in_use;
+    uint32_t seconds; // timed since the session was last saved in DB
+    char     rom_file[504];
+};
+
+/**
+ * @brief Crash-safe record of the sessions in progress, so a power cut only loses the time since
+ * their last checkpoint.
+ *
+ * @details The journal is a small preallocated file mapped in memory. The timer daemon holds an
+ * exclusive lock on it while running and checkpoints its sessions into slots, synced to storage
+ * with one page write. Whoever takes the lock next (the daemon restarting or the GUI while no
+ * daemon runs) folds the slots still in use into the DB.
+ */
+class Journal
+{
+  private:
+    Journal();
+    Journal(const Journal& copy);
+    Journal& operator=(const Journal& copy);
+
+    int          fd = -1;
+    JournalSlot* slots = nullptr;
+
+  public:
+    ~Journal();
+
+    static Journal& getInstance()
+    {
+        static Journal instance;
+        return instance;
+    }
+
+    bool open(bool wait);
+    void close();
+    int  recover();
+    int  acquire(const std::string& rom_file);
+    void checkpoint(int slot, long seconds);
+    void release(int slot);
+    void sync();
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Rom.h"
+
+#include <chrono>
+#include <cstdint>
+#include <linux/fb.h>
+
+/**
+ * @brief Measures how long a game takes to show its first frame after a launch or a resume.
+ *
+ * @details `begin` hashes a region at the center of the visible framebuffer, still showing the
+ * GUI, then `sample` is polled while waiting for the game until the hash changes. The latency is
+ * saved in DB with the system so slow launchers and cores stand out.
+ */
+class LatencyTracker
+{
+  private:
+    LatencyTracker();
+    LatencyTracker(const LatencyTracker& copy);
+    LatencyTracker& operator=(const LatencyTracker& copy);
+
+    Config& cfg;
+    DB&     db;
+
+    int                      fb_fd = -1;
+    void*                    fb_ptr = nullptr;
+    struct fb_fix_screeninfo finfo;
+
+    RomHandle                             handle; // of the game measured
+    bool                                  resumed = false;
+    uint64_t                              baseline = 0;
+    std::chrono::steady_clock::time_point start;
+
+    uint64_t frame_hash() const;
+    void     end();
+
+  public:
+    ~LatencyTracker();
+
+    static LatencyTracker& getInstance()
+    {
+        static LatencyTracker instance;
+        return instance;
+    }
+
+    void begin(const Rom& rom, bool resumed);
+    bool sample(const Rom& rom);
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <sys/types.h>
+
+// On tmpfs: shared memory between the timer daemon and the GUI, gone on reboot.
+#define LIVE_FILE "/tmp/activities_live"
+#define LIVE_SLOTS 8
+
+// State of a session timed by the daemon, as read by the GUI.
+struct LiveSession
+{
+    long long start_time; // epoch seconds
+    long long elapsed_ms; // timed and not yet in DB, up to now
+    bool      suspended;
+};
+
+/**
+ * @brief Sessions in progress published by the timer daemon for the GUI to read every frame.
+ *
+ * @details The daemon maps LIVE_FILE read-write and updates a slot per session when its state
+ * changes or its time is committed. Each slot is guarded by a seqlock: the writer makes its
+ * sequence odd while writing, readers copy the slot and retry if the sequence was odd or moved.
+ * The GUI so never blocks nor touches the DB to show a running counter, and only checks the DB
+ * once the daemon counted a commit.
+ */
+class LiveSessions
+{
+  private:
+    LiveSessions();
+    LiveSessions(const LiveSessions& copy);
+    LiveSessions& operator=(const LiveSessions& copy);
+
+    struct Data
+    {
+        uint32_t in_use;
+        uint32_t suspended;
+        int64_t  start_time;
+        int64_t  elapsed_ms;
+        int64_t  updated_ms; // CLOCK_MONOTONIC of elapsed_ms
+        char     rom_file[472];
+    };
+
+    struct Slot
+    {
+        std::atomic<uint32_t> sequence; // odd while written
+        Data                  data;
+    };
+
+    struct Segment
+    {
+        std::atomic<uint32_t> commits; // DB commits of the daemon
+        int32_t               owner;   // PID of the daemon
+        Slot                  slots[LIVE_SLOTS];
+    };
+
+    Segment* segment = nullptr;
+    bool     writable = false;
+
+    // GUI side
+    bool      owner_alive = false;
+    uint32_t  seen_commits = 0;
+    long long next_check_ms = 0;
+
+    bool map(bool write);
+    void write(int slot, const Data& data);
+    bool read(int slot, Data& data) const;
+
+  public:
+    ~LiveSessions();
+
+    static LiveSessions& getInstance()
+    {
+        static LiveSessions instance;
+        return instance;
+    }
+
+    // Daemon side
+    bool create();
+    int  acquire(const std::string& rom_file, long long start_time);
+    void publish(int slot, long long elapsed_ms, bool suspended);
+    void release(int slot);
+    void committed();
+
+    // GUI side
+    bool                       poll();
+    std::optional<LiveSession> find(const std::string& rom_file) const;
+};
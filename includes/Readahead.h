@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Config.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Warms the page cache with the rom hovered in the list or detail view.
+ *
+ * @details Once the same rom stayed selected for `readahead_dwell_ms`, a worker thread reads it,
+ * along with the files listed by a .cue or .m3u, up to `readahead_budget_mb`. Reads go by chunks
+ * so moving the selection cancels them within one chunk. The emulator first reads then hit the
+ * cache instead of the SD card.
+ */
+class Readahead
+{
+  private:
+    Readahead();
+    Readahead(const Readahead& copy);
+    Readahead& operator=(const Readahead& copy);
+
+    Config& cfg;
+
+    // GUI thread only
+    std::string                           hovered;
+    std::chrono::steady_clock::time_point hover_start;
+    bool                                  issued = false;
+
+    std::mutex              mutex;
+    std::condition_variable wake;
+    std::thread             worker;
+    std::string             pending; // rom handed to the worker
+    unsigned                pending_generation = 0;
+    bool                    stopping = false;
+    std::atomic<unsigned>   generation{0}; // bumped on every selection change
+
+    void   run();
+    size_t warm(const std::string& file, size_t budget, unsigned request) const;
+
+  public:
+    ~Readahead();
+
+    static Readahead& getInstance()
+    {
+        static Readahead instance;
+        return instance;
+    }
+
+    static std::vector<std::string> rom_files(const std::string& file);
+    static int                      cached_percent(const std::string& file);
+
+    void hover(const std::string& file);
+};
@@ -2,58 +2,91 @@
 
 #include "DB.h"
 #include "GUI.h"
+#include "RomTable.h"
 
+#include <optional>
 #include <string>
 
+// Environment variable tagging the processes of a game with its rom file.
+#define ROM_ENV "ACTIVITIES_ROM"
+// Games left suspended, resumed on the next start of the GUI.
+#define AUTOSTARTS_FILE "/mnt/SDCARD/Apps/Activities/data/autostarts.txt"
+
+/**
+ * @brief Handle over a row of the roms table.
+ *
+ * @details Rom holds no data by itself: every accessor reads the columns of the shared
+ * `RomTable`, so it is cheap to copy and never owns the game process. Accessors expect a
+ * `valid()` handle.
+ */
 class Rom
 {
   private:
     static GUI&    gui;
     static Config& cfg;
-    static DB&     db;
 
-    static std::vector<Rom>                list;
+    static RomTable                        list;
     static std::unordered_set<std::string> ra_hotkey_roms;
     static std::unordered_set<std::string> childs;
+    static std::unordered_set<std::string> stopped_cgroups; // removed once empty
+
+    RomHandle handle;
 
-    void   fill_opts();
-    void   update(DB_row row);
-    DB_row get_DB_row();
+    RomAssets& resolve(int assets);
+    void       terminate();
+    void       release_cgroup();
+    int        switch_menu();
 
   public:
-    Rom(DB_row row);
-    Rom(const std::string& file);
-    Rom(const std::string& file, int time);
-    ~Rom();
-
-    std::string file;            // #0 in games_datas
-    std::string name;            // #1 in games_datas
-    int         count = 0;       // #2 in games_datas
-    int         time = 0;        // #3 in games_datas
-    int         lastsessiontime = 0; // #4 in games_datas (duration in seconds)
-    std::string last = "-";      // #5 in games_datas
-    int         completed = 0;  // #6 in games_datas
-    int         favorite = 0;   // #7 in games_datas
-
-    std::string total_time;
-    std::string average_time;
-    std::string system;
-    std::string image;
-    std::string video;
-    std::string manual;
-    pid_t       pid = -1;
-    std::string launcher;
-
-    Rom* save();
+    Rom(RomHandle handle);
+
+    RomHandle get_handle() const { return handle; }
+    bool      valid() const;
+
+    std::string        file() const;
+    std::string        name() const;
+    int                count() const;
+    int                time() const;
+    int                lastsessiontime() const;
+    std::string        last() const;
+    int                completed() const;
+    int                favorite() const;
+    pid_t              pid() const;
+    const std::string& system() const;
+    std::string        total_time() const;
+    std::string        average_time() const;
+    long               memory_current() const;
+    long               cpu_usage_usec() const;
+
+    const std::string& get_image();
+    const std::string& get_video();
+    const std::string& get_manual();
+    const std::string& get_launcher();
+    void               set_launcher(const std::string& new_launcher);
+    void               prefetch();
+
+    void set_completed(int completed);
+    void set_favorite(int favorite);
+
+    void save();
     void remove();
 
     void start();
     void stop();
     void suspend();
+    void freeze();
+    void thaw();
     int  wait();
 
-    static void              export_childs_list();
-    static void              refresh();
-    static std::vector<Rom>& get();
-    static Rom*              get(const std::string& rom_file);
+    static void               save_session(const std::string& rom_file, int time);
+    static void               save_profile(
+        const std::string& rom_file, int time, const SessionProfile& profile);
+    static Rom                add(const std::string& rom_file);
+    static int                adopt_orphans();
+    static void               release_all();
+    static void               remove_cgroups();
+    static void               export_childs_list();
+    static void               refresh();
+    static RomTable&          get();
+    static std::optional<Rom> get(const std::string& rom_file);
 };
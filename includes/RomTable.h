@@ -0,0 +1,123 @@
+#pragma once
+
+#include "DB.h"
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <sys/types.h>
+#include <unordered_map>
+#include <vector>
+
+// Assets of a rom that are only resolved on first access.
+enum
+{
+    ASSET_IMAGE = 1,
+    ASSET_VIDEO = 2,
+    ASSET_MANUAL = 4,
+    ASSET_LAUNCHER = 8,
+    ASSET_ALL = 15
+};
+
+/**
+ * @brief Interns a small set of often repeated strings (systems, launchers) as 16 bits ids.
+ */
+class StringPool
+{
+  private:
+    std::vector<std::string>                  strings;
+    std::unordered_map<std::string, uint16_t> ids;
+
+  public:
+    static constexpr uint16_t npos = 0xFFFF;
+
+    uint16_t           intern(const std::string& str);
+    uint16_t           find(const std::string& str) const;
+    const std::string& get(uint16_t id) const { return strings[id]; }
+    size_t             size() const { return strings.size(); }
+    size_t             memory_usage() const;
+};
+
+struct RomAssets
+{
+    std::string image;
+    std::string video;
+    std::string manual;
+    int         resolved = 0; // ASSET_* flags already resolved
+};
+
+/**
+ * @brief Stable reference to a row of the RomTable.
+ *
+ * @details Rows are never moved, so a handle survives any insert or removal of other rows. Its
+ * generation tells apart a removed row from a later one reusing the same slot.
+ */
+struct RomHandle
+{
+    uint32_t row = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool operator==(const RomHandle& other) const
+    {
+        return row == other.row && generation == other.generation;
+    }
+    bool operator!=(const RomHandle& other) const { return !(*this == other); }
+};
+
+/**
+ * @brief Columnar (struct-of-arrays) storage of the roms list.
+ *
+ * @details Each field lives in its own contiguous column indexed by row, so filtering and sorting
+ * only walk the columns they compare. Systems and launchers are interned, file paths and names
+ * are stored NUL terminated in a single arena and referenced by offset. Assets paths are only
+ * resolved for the few rows displayed and so kept in a sparse map.
+ *
+ * Rows are slots of a slot-map: a removed row is only marked free and reused by the next insert,
+ * making both O(1) without ever moving other rows. Iterations over `rows()` skip dead slots.
+ */
+class RomTable
+{
+  public:
+    typedef uint32_t Row;
+
+  private:
+    std::vector<char> arena;      // NUL terminated file paths and names
+    size_t            wasted = 0; // arena bytes still owned by removed rows
+    std::vector<Row>  free_rows;
+
+    uint32_t store(const std::string& str);
+    void     compact();
+
+  public:
+    std::vector<uint32_t> generation; // odd while the row is alive
+    std::vector<uint32_t> file;       // arena offsets
+    std::vector<uint32_t> name; // arena offsets
+    std::vector<int32_t>  count;
+    std::vector<int32_t>  time;
+    std::vector<int32_t>  lastsessiontime;
+    std::vector<time_t>   last; // 0 when never played
+    std::vector<uint8_t>  completed;
+    std::vector<uint8_t>  favorite;
+    std::vector<pid_t>    pid;
+    std::vector<uint16_t> system;   // ids in `systems`
+    std::vector<uint16_t> launcher; // ids in `launchers`, StringPool::npos until resolved
+
+    StringPool                           systems;
+    StringPool                           launchers;
+    std::unordered_map<Row, RomAssets>   assets;
+    std::unordered_map<Row, std::string> cgroup; // of running games, when cgroups are available
+
+    size_t      rows() const { return generation.size(); }
+    size_t      size() const { return rows() - free_rows.size(); }
+    bool        empty() const { return size() == 0; }
+    bool        alive(Row row) const { return generation[row] & 1; }
+    bool        valid(RomHandle handle) const;
+    RomHandle   handle(Row row) const { return {row, generation[row]}; }
+    const char* str(uint32_t offset) const { return arena.data() + offset; }
+
+    RomHandle insert(const DB_row& db_row, const std::string& system_name);
+    void      update(Row row, const DB_row& db_row);
+    void      remove(RomHandle handle);
+    RomHandle find(const std::string& file_path) const;
+    size_t    memory_usage() const;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Rom.h"
+
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+/**
+ * @brief Hidden `activities suspend-check` command: checks which suspended games the
+ * SuspendManager evicts, and how.
+ *
+ * @details Fake games are forked, each in its own process group (and cgroup when available),
+ * holding a known amount of memory. Two of them stand for RetroArch: they share a UDP socket bound
+ * on `retroarch_cmd_port` (IPv4, or IPv6 with `-ipv6`), save a state and report every command
+ * they receive, one of them not being our child as adopted games. They are added as running roms
+ * of a temporary instance (INSTANCE_ENV), with its own DB and autostarts.txt, then suspended and
+ * resumed as the GUI does, under a budget fitting two of them. The check asserts that nothing is
+ * evicted within the budget, that once over it the least recently suspended game able to save is
+ * sent SAVE_STATE then QUIT without waiting out the timeouts, and that the others are left
+ * suspended.
+ */
+class SuspendCheck
+{
+  private:
+    struct Game
+    {
+        Rom         rom;
+        pid_t       pid;
+        std::string cgroup;
+        int         commands_fd; // read end of the commands received, -1 if not RetroArch
+    };
+
+    static Game        spawn_game(const std::string& instance, const std::string& name, int mb,
+               int socket_fd, bool adopted);
+    static void        suspend(const Game& game);
+    static void        resume(const Game& game);
+    static std::string commands(const Game& game);
+    static bool        expect(bool condition, const std::string& what);
+
+  public:
+    static int run(int argc, char** argv);
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Rom.h"
+
+#include <list>
+#include <unordered_map>
+
+// Longest wait for an evicted game to save its state, then to quit.
+#define EVICT_SAVE_TIMEOUT_MS 3000
+#define EVICT_QUIT_TIMEOUT_MS 5000
+
+/**
+ * @brief Keeps the memory held by suspended games under a budget.
+ *
+ * @details Suspended games are kept in least recently used order. Once their resident memory
+ * exceeds `suspended_memory_budget_mb`, the oldest ones are asked over the RetroArch network
+ * command port to save their state and quit, which also drops them from autostarts.txt.
+ *
+ * With `suspend_pageout`, the anonymous memory of a game is also paged out as soon as it is
+ * suspended, and the cost of bringing it back measured when the game is resumed.
+ */
+class SuspendManager
+{
+    friend class SuspendCheck;
+
+  private:
+    SuspendManager();
+    SuspendManager(const SuspendManager& copy);
+    SuspendManager& operator=(const SuspendManager& copy);
+
+    Config& cfg;
+    GUI&    gui;
+
+    std::list<RomHandle> suspended_roms; // least recently suspended first
+
+    // Paged out games being resumed, until their memory is swapped back in
+    struct ResumeSample
+    {
+        RomHandle     handle;
+        Uint32        start;
+        size_t        rss;
+        unsigned long majflt;      // at resume
+        unsigned long last_majflt; // at the previous sample
+    };
+    std::list<RomHandle>                            paged_out_roms;
+    std::unordered_map<RomTable::Row, ResumeSample> resuming;
+
+    bool evict(Rom rom);
+    void page_out(const Rom& rom);
+
+  public:
+    static SuspendManager& getInstance()
+    {
+        static SuspendManager instance;
+        return instance;
+    }
+
+    void   suspended(const Rom& rom);
+    void   resumed(const Rom& rom);
+    void   forget(const Rom& rom);
+    bool   sample_resume(const Rom& rom);
+    size_t memory_usage() const;
+    void   enforce_budget();
+};
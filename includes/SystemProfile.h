@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Config.h"
+
+#include <chrono>
+#include <sched.h>
+#include <string>
+#include <vector>
+
+// Time given to a launched game to start before its helpers are no longer looked for.
+#define SCHEDULE_PENDING_S 30
+
+// Settings of a cpu, as read from or written to cpufreq sysfs. Empty fields are left unchanged.
+struct CpuState
+{
+    std::string online; // empty for cpus that can not go offline
+    std::string governor;
+    std::string min_freq; // kHz
+    std::string max_freq;
+};
+
+/**
+ * @brief Applies per system performance profiles while a game is in the foreground.
+ *
+ * @details A profile is read from the `cpu_profile.<system>` setting (or `cpu_profile.default`)
+ * as `governor,min_freq,max_freq,online_cores`, any field may be left empty to keep it. The cpus
+ * state is saved when a profile is applied and written back on restore. Files are looked up under
+ * `cpufreq_root` so a fake tree can stand for /sys/devices/system/cpu.
+ *
+ * The scheduling side gives the game in front its nice value and cpus (`game_nice.<system>`,
+ * `game_cpus.<system>`), moves its helper processes to SCHED_BATCH and steps the GUI back to
+ * `gui_nice` on `gui_cpus` until restore.
+ */
+class SystemProfile
+{
+  private:
+    SystemProfile();
+    SystemProfile(const SystemProfile& copy);
+    SystemProfile& operator=(const SystemProfile& copy);
+
+    Config& cfg;
+
+    std::vector<CpuState>                 saved; // empty while no profile is applied
+    std::string                           system;
+    int                                   battery_start = -1;
+    std::chrono::steady_clock::time_point start;
+
+    int       gui_nice; // GUI scheduling before any game
+    cpu_set_t gui_cpus;
+    bool      gui_in_background = false;
+
+    // Group applied while it only ran helpers, scheduled again once the game started
+    pid_t                                 pending_pgid = -1;
+    std::string                           pending_system;
+    std::chrono::steady_clock::time_point pending_since;
+
+    std::string cpu_path(size_t cpu) const;
+    size_t      cpu_count() const;
+    CpuState    read_cpu(size_t cpu) const;
+    void        write_cpu(size_t cpu, const CpuState& state) const;
+    int         battery_capacity() const;
+    double      battery_power() const;
+    void        apply_cpu_profile(const std::string& system);
+    void        restore_cpu_profile();
+    bool        schedule_game(const std::string& system, pid_t pgid) const;
+
+  public:
+    static SystemProfile& getInstance()
+    {
+        static SystemProfile instance;
+        return instance;
+    }
+
+    int       game_nice(const std::string& system) const;
+    cpu_set_t game_cpus(const std::string& system) const;
+
+    void apply(const std::string& system, pid_t pgid);
+    bool schedule_pending();
+    void restore();
+};
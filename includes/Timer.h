@@ -1,41 +1,109 @@
 #pragma once
 
+#include "DB.h"
+
+#include <ctime>
 #include <fcntl.h>
 #include <string>
 #include <sys/inotify.h>
 #include <sys/stat.h>
-#include <sys/time.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
+#define FLAG_LOG "/mnt/SDCARD/Apps/Activities/log/file_watcher.log"
+
+// Bounds of the /proc polling interval used when the game has no cgroup to watch.
+#define TIMER_MIN_INTERVAL_MS 250
+#define TIMER_MAX_INTERVAL_MS 4000
+// Interval the activity of a running game is sampled at, with idle tracking
+#define TIMER_IDLE_SAMPLE_MS 5000
+// Interval the peak RSS and storage reads of a running game are sampled at
+#define TIMER_PROFILE_SAMPLE_MS 30000
+// Analog axes watched for input, from ABS_X
+#define TIMER_AXES 6
+
+/**
+ * @brief Times a game session, counting only the time the game is not stopped.
+ *
+ * @details The owner waits on `pid_fd` for the exit of the game and on `events_fd` (POLLPRI), the
+ * cgroup.events of its cgroup, for freezes and thaws, then calls `update`. A session so costs a
+ * few wakeups. Without a cgroup, stops by signal only show in /proc/<pid>/stat, which `update`
+ * also has to be called for once `timeout` expires, an interval backing off while the state does
+ * not change.
+ *
+ * Time is summed from CLOCK_MONOTONIC deltas between state checks, which do not include the
+ * device sleeping. Sleep still shows as the part of the CLOCK_BOOTTIME delta the monotonic one
+ * lacks, and is only logged.
+ *
+ * With `idle_timeout_s`, each delta is also classified as idle when the gamepad had no input for
+ * that long or the game barely used the CPU (its menu, a pause), checked at least every
+ * TIMER_IDLE_SAMPLE_MS. The CPU time comes from the /proc/<pid>/stat read anyway, or the cpu.stat
+ * of the cgroup, and the input events queued by evdev are only drained then, so playing does not
+ * wake the timer up.
+ *
+ * The resources used by each session are profiled from the same CPU time, and the peak RSS and
+ * storage reads of the game in /proc/<pid>/status and io, cumulative counters sampled every
+ * TIMER_PROFILE_SAMPLE_MS and on state changes.
+ */
 class Timer
 {
   private:
-    Timer();
-    Timer(const std::string& pid);
     Timer(const Timer& copy);
     Timer& operator=(const Timer& copy);
 
-    // Timer(const Timer&) = delete;
-    // Timer& operator=(const Timer&) = delete;
+    int fd = -1;
+    int events_fd = -1; // cgroup.events of the game cgroup, if any
+    int pidfd = -1;
+
+    long long elapsed_ms = 0; // of the current session
+    long long since_ms;       // CLOCK_MONOTONIC of the previous check
+    long long since_boot_ms;  // CLOCK_BOOTTIME of the previous check
+    long long next_check_ms;
+    char      previous = 0;
+    int       interval = TIMER_MIN_INTERVAL_MS;
+    bool      has_exited = false;
 
-    int                    fd = -1;
-    volatile bool          running = false;
-    volatile bool          suspended = false;
-    volatile unsigned long elapsed_seconds = 0;
-    volatile unsigned int  tick_counter = 0;
+    // Idle tracking, if input_fd is open
+    int       input_fd = -1;
+    int       cpu_fd = -1;  // cpu.stat of the game cgroup, else the /proc stat is used
+    long long cpu_ms = -1;  // CPU time of the game at the previous check
+    long long input_ms = 0; // CLOCK_MONOTONIC of the last input
+    long long idle_ms = 0;  // part of elapsed_ms
+    long long next_sample_ms = 0;
+    long      ended_idle = 0;
+    int       axis_rest[TIMER_AXES];
+    int       axis_threshold[TIMER_AXES];
+
+    // Resources profile of the current session
+    int            status_fd = -1;
+    int            io_fd = -1;
+    long long      session_cpu_ms = -1; // CPU time of the game when the session started
+    long long      session_read_kb = -1;
+    long long      read_kb = -1;
+    long           peak_rss_kb = -1;
+    long long      next_profile_ms = 0;
+    SessionProfile ended_profile = {-1, -1, -1};
+
+    char state(long long* cpu_ticks = nullptr);
+    void open_input();
+    bool played(long long delta_ms, long long cpu_now_ms, long long now_ms);
+    void sample_resources();
+    void end_profile(long seconds);
 
   public:
+    Timer(pid_t pid);
     ~Timer();
 
-    static Timer& getInstance(const std::string& pid = "")
-    {
-        static Timer instance(pid);
-        return instance;
-    }
-
-    static void daemonize(const std::string& rom_file, const std::string& program_pid);
-    static void timer_handler(int signum);
+    int       pid_fd() const { return pidfd; }
+    int       cgroup_events_fd() const { return events_fd; }
+    bool      exited() const { return has_exited; }
+    bool      running() const { return !has_exited && previous && previous != 'T'; }
+    long long elapsed() const;
+    long      idle() const { return input_fd == -1 ? -1 : ended_idle; }
+    const SessionProfile& profile() const { return ended_profile; }
+    int       timeout() const;
+    long      update();
 
-    long run();
+    static long long clock_ms(clockid_t clock);
+    static int       watch_flag(const std::string& flag, const std::string& rom_file = "");
 };
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Hidden `activities timer-check` command: checks the accuracy and cost of the Timer
+ * against known durations.
+ *
+ * @details Child processes are run, stopped, continued and killed along scripted timelines, frozen
+ * through a cgroup when available (as games are) or by signals. The Timer is driven like in the
+ * daemon, and the time it records compared with the running time the timelines actually gave,
+ * optionally while busy threads load every core. Each run also reports the wakeups and CPU time
+ * the timing took.
+ *
+ * With `-daemon`, two games are then timed end to end by a timer daemon, isolated in a temporary
+ * instance (INSTANCE_ENV) with its own DB. Their `activities time` clients run from inside their
+ * cgroup as launch scripts do, the first one starting the daemon, and the sessions saved are
+ * compared with the truth, along with the wakeups and CPU of the daemon.
+ */
+class TimerCheck
+{
+  private:
+    struct Result
+    {
+        long long truth_ms;
+        long long timed_ms;
+        long long duration_ms;
+        int       wakeups;
+        long long cpu_us; // of the timing thread
+    };
+
+    static pid_t       spawn_game(const std::string& cgroup);
+    static pid_t       spawn_client(const std::string& cgroup, const std::string& rom, pid_t pid);
+    static std::thread follow(pid_t pid, const std::string& cgroup,
+        const std::vector<int>& schedule_ms, std::atomic<long long>& truth_ms);
+    static Result      run_once(const std::string& cgroup, const std::vector<int>& schedule_ms);
+    static bool        check_daemon(const std::string& cgroup, long long tolerance_ms);
+
+  public:
+    static int run(int argc, char** argv);
+};
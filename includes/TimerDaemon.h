@@ -0,0 +1,94 @@
+#pragma once
+
+#include "DB.h"
+#include "Journal.h"
+#include "LiveSessions.h"
+#include "Timer.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Abstract unix socket (leading NUL) of the daemon: no file left behind, a single owner at once.
+#define TIMERD_SOCKET "\0activities_timerd"
+#define TIMERD_LOG "/mnt/SDCARD/Apps/Activities/log/timer.log"
+// Delay sessions are grouped by before being committed together.
+#define TIMERD_COMMIT_DELAY_MS 1000
+
+/**
+ * @brief Single daemon timing every game, `activities timerd`.
+ *
+ * @details `activities time <rom> <pid>` connects to its socket, starting it if needed, sends a
+ * `track` request and waits for the game to exit. All the sessions are multiplexed in one epoll
+ * loop over their pidfd and cgroup.events, and share one DB connection whose writes are grouped
+ * in a transaction committed after TIMERD_COMMIT_DELAY_MS, or at once when a game exits, and
+ * retried while the GUI holds the DB.
+ *
+ * Each session also holds a slot of the Journal, refreshed after every commit and each
+ * `checkpoint_minutes`, so the time of a game still running survives a power cut, and a slot of
+ * LiveSessions the GUI reads to show it running.
+ */
+class TimerDaemon
+{
+  private:
+    TimerDaemon();
+    TimerDaemon(const TimerDaemon& copy);
+    TimerDaemon& operator=(const TimerDaemon& copy);
+
+    struct Session
+    {
+        std::string            rom_file;
+        std::unique_ptr<Timer> timer;
+        int                    client = -1; // waiting for the exit of the game
+        int                    journal_slot = -1;
+        int                    live_slot = -1;
+    };
+
+    DB&           db;
+    Journal&      journal;
+    LiveSessions& live;
+
+    int epoll_fd = -1;
+    int listen_fd = -1;
+    int signal_fd = -1;
+
+    std::unordered_map<int, std::string>  requests; // clients until their request is read
+    std::vector<std::unique_ptr<Session>> sessions;
+    std::unordered_map<int, Session*>     session_fds; // pidfd and cgroup.events of sessions
+    std::chrono::steady_clock::time_point commit_deadline;
+    bool                                  in_transaction = false;
+    std::vector<int>                      exited_slots; // journal slots to release once committed
+    std::chrono::steady_clock::time_point checkpoint_deadline;
+    std::chrono::minutes                  checkpoint_interval;
+
+    bool listen_socket();
+    void watch(int fd, uint32_t events);
+    void accept_client();
+    void read_request(int client);
+    void start_session(int client, const std::string& rom_file, pid_t pid);
+    void update(Session* session);
+    void end_session(Session* session);
+    void save(const std::string& rom_file, long seconds, const Timer& timer);
+    void commit();
+    void committed();
+    void checkpoint();
+    void publish(Session* session);
+    int  next_timeout() const;
+
+  public:
+    ~TimerDaemon();
+
+    static TimerDaemon& getInstance()
+    {
+        static TimerDaemon instance;
+        return instance;
+    }
+
+    static int  connect_socket();
+    static void daemonize();
+    static int  track(const std::string& rom_file, const std::string& pid);
+
+    int serve();
+};
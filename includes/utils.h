@@ -3,9 +3,13 @@
 using json = nlohmann::json;
 
 #include <fcntl.h>
+#include <sched.h>
 #include <string>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <unordered_map>
+#include <vector>
 
 #if __has_include(<filesystem>)
 #    include <filesystem>
@@ -19,18 +23,65 @@ namespace fs = std::experimental::filesystem;
 
 #define __STDC_WANT_LIB_EXT1__ 1
 
+// Directory holding the data of an isolated timer daemon instead of its usual paths (DB, journal,
+// live sessions, socket), as run by `activities timer-check -daemon`.
+#define INSTANCE_ENV "ACTIVITIES_INSTANCE"
+
+// Fields of /proc/<pid>/stat used here.
+struct ProcStat
+{
+    char          state = 0;
+    pid_t         pgrp = 0;
+    unsigned long majflt = 0;
+    unsigned long utime = 0; // clock ticks
+    unsigned long stime = 0;
+};
+
 namespace utils
 {
 std::string getCurrentDateTime();
 std::string sec2hhmmss(int total_seconds);
 std::string stringifyTime(int total_seconds);
 std::string stringifyDate(const std::string& date);
+time_t      parseDateTime(const std::string& date);
+std::string formatDateTime(time_t date);
 pid_t       get_pid_of_process(const std::string& command);
 pid_t       get_pgid_of_process(pid_t pid);
 void        suspend_process_group(pid_t pgid);
 void        resume_process_group(pid_t pgid);
 void        kill_process_group(pid_t pgid);
 int         get_process_status(int fd);
+bool        read_proc_stat(pid_t pid, ProcStat& stat);
+std::vector<pid_t> get_process_group_pids(pid_t pgid);
+unsigned long      get_process_group_cpu_ticks(pid_t pgid);
+unsigned long      get_process_group_majflt(pid_t pgid);
+unsigned long long get_process_group_write_bytes(pid_t pgid);
+bool               process_group_uses_av_device(pid_t pgid);
+size_t             get_process_group_rss(pid_t pgid);
+bool               process_group_owns_udp_port(pid_t pgid, int port, int* family = nullptr);
+bool               send_udp_command(int port, const std::string& command, int family = AF_INET);
+bool               page_out_process_group(pid_t pgid);
+std::unordered_map<pid_t, std::string> find_process_groups_by_env(const std::string& name);
+void               set_cloexec_on_all_fds();
+std::string        get_process_name(pid_t pid);
+void               set_process_nice(pid_t pid, int nice);
+void               set_process_affinity(pid_t pid, const cpu_set_t& cpus);
+void               set_process_batch(pid_t pid);
+int                open_gamepad_evdev(const std::string& name);
+std::vector<int>   get_evdev_buttons(int fd);
+int                pidfd_open(pid_t pid);
+bool               daemonize(const std::string& log_file);
+std::string        instance_path(const std::string& path);
+bool               parse_cpu_list(const std::string& list, cpu_set_t& cpus);
+// cgroup v2 helpers
+std::string get_process_cgroup(pid_t pid);
+std::string cgroup_create(const std::string& root, const std::string& name);
+bool        cgroup_write(const std::string& cgroup, const std::string& file, const char* value);
+bool        cgroup_leave(const std::string& root, const std::string& name);
+std::string cgroup_read(const std::string& cgroup, const std::string& file);
+bool        cgroup_populated(const std::string& cgroup);
+void        cgroup_signal(const std::string& cgroup, int signum);
+bool        cgroup_remove(const std::string& cgroup);
 // Hotkey file helpers
 bool ra_hotkey_exists();
 void remove_ra_hotkey();
@@ -1,7 +1,11 @@
 #include "Activities.h"
 
+#include "Journal.h"
+#include "LiveSessions.h"
+#include "Readahead.h"
 #include "utils.h"
 
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <set>
@@ -18,29 +22,42 @@ Activities::Activities()
 
 Activities::~Activities()
 {
+    Rom::release_all();
+}
+
+// Interned id of the system filtered on, StringPool::npos for "All".
+uint16_t Activities::current_system_id() const
+{
+    if (system_index == 0 || system_index >= systems.size())
+        return StringPool::npos;
+    return roms_list.systems.find(systems[system_index]);
+}
+
+bool Activities::matches_filters(RomTable::Row row, uint16_t system_id) const
+{
+    if (system_id != StringPool::npos && roms_list.system[row] != system_id)
+        return false;
+
+    bool running = roms_list.pid[row] != -1;
+    // != Unmatch mean All and Match;  < Match mean All and Unmatch
+    return ((filters_states.running != FilterState::Unmatch && running) ||
+               (filters_states.running < FilterState::Match && !running)) &&
+           ((filters_states.favorites != FilterState::Unmatch && roms_list.favorite[row]) ||
+               (filters_states.favorites < FilterState::Match && !roms_list.favorite[row])) &&
+           ((filters_states.completed != FilterState::Unmatch && roms_list.completed[row]) ||
+               (filters_states.completed < FilterState::Match && !roms_list.completed[row]));
 }
 
 void Activities::filter_roms()
 {
-    // Safety check to avoid out-of-bounds access
-    std::string current_system = "All";
-    if (!systems.empty() && system_index < systems.size())
-        current_system = systems[system_index];
+    uint16_t system_id = current_system_id();
 
     filtered_roms_list.clear();
     total_time = 0;
-    for (auto it = roms_list.begin(); it != roms_list.end(); it++) {
-        if (it->system == current_system || system_index == 0) {
-            // != Unmatch mean All and Match;  < Match mean All and Unmatch
-            if (((filters_states.running != FilterState::Unmatch && it->pid != -1) ||
-                    (filters_states.running < FilterState::Match && it->pid == -1)) &&
-                ((filters_states.favorites != FilterState::Unmatch && it->favorite == 1) ||
-                    (filters_states.favorites < FilterState::Match && it->favorite == 0)) &&
-                ((filters_states.completed != FilterState::Unmatch && it->completed == 1) ||
-                    (filters_states.completed < FilterState::Match && it->completed == 0))) {
-                filtered_roms_list.push_back(it);
-                total_time += it->time;
-            }
+    for (RomTable::Row row = 0; row < roms_list.rows(); row++) {
+        if (roms_list.alive(row) && matches_filters(row, system_id)) {
+            filtered_roms_list.push_back(roms_list.handle(row));
+            total_time += roms_list.time[row];
         }
     }
     list_size = filtered_roms_list.size();
@@ -51,39 +68,62 @@ void Activities::filter_roms()
         selected_index = list_size == 0 ? 0 : static_cast<int>(list_size - 1);
 }
 
-void Activities::sort_roms()
+bool Activities::rom_less(RomTable::Row a, RomTable::Row b) const
 {
-    bool              rev = reverse_sort;
+    if (reverse_sort)
+        std::swap(a, b);
     switch (sort_by) {
     case Sort::Name:
-        std::sort(filtered_roms_list.begin(), filtered_roms_list.end(),
-            [rev](std::vector<Rom>::iterator a, std::vector<Rom>::iterator b) {
-                bool ret = a->name < b->name;
-                return rev ? !ret : ret;
-            });
-        break;
-    case Sort::Time:
-        std::sort(filtered_roms_list.begin(), filtered_roms_list.end(),
-            [rev](std::vector<Rom>::iterator a, std::vector<Rom>::iterator b) {
-                bool ret = a->total_time > b->total_time;
-                return rev ? !ret : ret;
-            });
-        break;
-    case Sort::Count:
-        std::sort(filtered_roms_list.begin(), filtered_roms_list.end(),
-            [rev](std::vector<Rom>::iterator a, std::vector<Rom>::iterator b) {
-                bool ret = a->count > b->count;
-                return rev ? !ret : ret;
-            });
-        break;
-    case Sort::Last:
-        std::sort(filtered_roms_list.begin(), filtered_roms_list.end(),
-            [rev](std::vector<Rom>::iterator a, std::vector<Rom>::iterator b) {
-                bool ret = a->last > b->last;
-                return rev ? !ret : ret;
-            });
-        break;
+        return std::strcmp(roms_list.str(roms_list.name[a]), roms_list.str(roms_list.name[b])) < 0;
+    case Sort::Time: return roms_list.time[a] > roms_list.time[b];
+    case Sort::Count: return roms_list.count[a] > roms_list.count[b];
+    case Sort::Last: return roms_list.last[a] > roms_list.last[b];
+    }
+    return false;
+}
+
+void Activities::sort_roms()
+{
+    std::sort(filtered_roms_list.begin(), filtered_roms_list.end(),
+        [this](RomHandle a, RomHandle b) { return rom_less(a.row, b.row); });
+    gui.reset_scroll();
+}
+
+/**
+ * @brief Updates the filtered list for a single rom instead of rebuilding it.
+ *
+ * @details The rom is dropped from the list if it was removed from the table or no longer
+ * matches the filters, and (re)inserted at its sorted position otherwise. Handles of other roms
+ * are unaffected so the selection stays on the same rom when possible.
+ *
+ * @param rom The handle of the rom that changed.
+ */
+void Activities::update_filtered(RomHandle rom)
+{
+    RomHandle selected =
+        selected_index < filtered_roms_list.size() ? filtered_roms_list[selected_index] : rom;
+
+    auto it = std::find(filtered_roms_list.begin(), filtered_roms_list.end(), rom);
+    if (it != filtered_roms_list.end()) {
+        filtered_roms_list.erase(it);
+        total_time -= roms_list.time[rom.row];
     }
+    if (roms_list.valid(rom) && matches_filters(rom.row, current_system_id())) {
+        filtered_roms_list.insert(std::upper_bound(filtered_roms_list.begin(),
+                                      filtered_roms_list.end(), rom,
+                                      [this](RomHandle a, RomHandle b) {
+                                          return rom_less(a.row, b.row);
+                                      }),
+            rom);
+        total_time += roms_list.time[rom.row];
+    }
+    list_size = filtered_roms_list.size();
+
+    it = std::find(filtered_roms_list.begin(), filtered_roms_list.end(), selected);
+    if (it != filtered_roms_list.end())
+        selected_index = std::distance(filtered_roms_list.begin(), it);
+    else if (selected_index >= list_size)
+        selected_index = list_size == 0 ? 0 : list_size - 1;
     gui.reset_scroll();
 }
 
@@ -107,55 +147,55 @@ MenuResult Activities::switch_filter(const std::string& label, int& state)
     return MenuResult::ExitAll;
 }
 
-void Activities::game_menu(std::vector<Rom>::iterator rom)
+void Activities::game_menu(Rom rom)
 {
     std::vector<std::pair<std::string, MenuAction>> menu_items;
 
     if (filtered_roms_list.empty())
         return;
-    menu_items = {{rom->pid == -1 ? "Start" : "Resume",
-                      [this, rom]() -> MenuResult {
-                          rom->start();
-                          handle_game_return(rom->wait());
+    menu_items = {{rom.pid() == -1 ? "Start" : "Resume",
+                      [this, &rom]() -> MenuResult {
+                          rom.start();
+                          handle_game_return(rom.wait());
                           return MenuResult::ExitAll;
                       }},
-        {rom->completed ? "Uncomplete" : "Complete",
+        {rom.completed() ? "Uncomplete" : "Complete",
             [this, &rom]() -> MenuResult {
-                rom->completed = rom->completed ? 0 : 1;
-                rom->save();
-                filter_roms();
+                rom.set_completed(rom.completed() ? 0 : 1);
+                rom.save();
+                update_filtered(rom.get_handle());
                 return MenuResult::ExitAll;
             }},
-        {rom->favorite ? "UnFavorite" : "Favorite",
-            [&rom]() -> MenuResult {
-                rom->favorite = rom->favorite ? 0 : 1;
-                rom->save();
+        {rom.favorite() ? "UnFavorite" : "Favorite",
+            [this, &rom]() -> MenuResult {
+                rom.set_favorite(rom.favorite() ? 0 : 1);
+                rom.save();
+                update_filtered(rom.get_handle());
                 return MenuResult::ExitAll;
             }},
         {"Remove DB entry",
             [this, &rom]() -> MenuResult {
                 if (gui.confirmation_popup("Remove game from DB?", FONT_MIDDLE_SIZE)) {
-                    rom->remove();
-                    filter_roms();
+                    rom.remove();
+                    update_filtered(rom.get_handle());
                 }
                 return MenuResult::ExitAll;
             }},
         {"Change Launcher", [this, &rom]() -> MenuResult {
-             std::vector<std::string> launchers = utils::get_launchers(rom->system);
+             std::vector<std::string> launchers = utils::get_launchers(rom.system());
              std::string              str =
                  gui.string_selector("Select new launcher:", launchers, gui.Width / 2, true);
              if (!str.empty()) {
-                 utils::set_launcher(rom->system, rom->name, str);
-                 rom->launcher = str;
+                 rom.set_launcher(str);
                  return MenuResult::ExitAll;
              }
              return MenuResult::Continue;
          }}};
 
-    if (rom->pid != -1)
-        menu_items.insert(menu_items.begin() + 1, {"Stop", [this, rom]() -> MenuResult {
-                                                       rom->stop();
-                                                       filter_roms();
+    if (rom.pid() != -1)
+        menu_items.insert(menu_items.begin() + 1, {"Stop", [this, &rom]() -> MenuResult {
+                                                       rom.stop();
+                                                       update_filtered(rom.get_handle());
                                                        return MenuResult::ExitAll;
                                                    }});
     gui.save_background_texture();
@@ -261,6 +301,8 @@ void Activities::global_menu()
 
 void Activities::handle_game_return(int wait_status)
 {
+    gui.leave_background();
+    stats_file.clear();
     switch (wait_status) {
     case 1:
         sort_by = Sort::Last;
@@ -345,11 +387,19 @@ void Activities::game_list()
                        : std::max(0, static_cast<int>(selected_index) - LIST_LINES / 2);
     size_t last = std::min(first + LIST_LINES, filtered_roms_list.size());
 
+    // Resolve assets of visible rows and of the ones about to scroll into view.
+    for (size_t j = first > 0 ? first - 1 : 0; j < std::min(last + 1, list_size); j++)
+        Rom(filtered_roms_list[j]).prefetch();
+    if (selected_index < list_size) {
+        Rom selected(filtered_roms_list[selected_index]);
+        Readahead::getInstance().hover(selected.pid() == -1 ? selected.file() : "");
+    }
+
     int y = 80;
     int x = 10;
 
     for (size_t j = first; j < last; j++) {
-        std::vector<Rom>::iterator rom = filtered_roms_list[j];
+        Rom       rom(filtered_roms_list[j]);
         SDL_Color color = (j == selected_index) ? cfg.selected_color : cfg.unselect_color;
 
         prevSize = gui.render_image(cfg.theme_path + "skin/list-item-1line-sort-bg-" +
@@ -358,15 +408,15 @@ void Activities::game_list()
 
         int offset = 5;
 
-        if (rom->completed)
+        if (rom.completed())
             offset += gui.render_image(std::string(APP_DIR) + "/.assets/green_check.svg",
                              x + offset, y + FONT_MIDDLE_SIZE / 2, 16, 16, IMG_NONE)
                           .x;
-        if (rom->favorite)
+        if (rom.favorite())
             offset += gui.render_image(cfg.theme_path + "skin/icon-star.png", x + offset,
                              y + FONT_MIDDLE_SIZE / 2, 16, 16, IMG_NONE)
                           .x;
-        if (rom->pid != -1)
+        if (rom.pid() != -1)
             offset += gui.render_image(std::string(APP_DIR) + "/.assets/green_dot.svg", x + offset,
                              y + FONT_MIDDLE_SIZE / 2, 16, 16, IMG_NONE)
                           .x;
@@ -374,23 +424,23 @@ void Activities::game_list()
         // Display game name (accounting for the icons)
         if (j == selected_index) {
             gui.render_scrollable_text(
-                rom->name, x + offset, y + 2, prevSize.x - 5 - offset, FONT_MIDDLE_SIZE, color);
+                rom.name(), x + offset, y + 2, prevSize.x - 5 - offset, FONT_MIDDLE_SIZE, color);
         } else {
             gui.render_text(
-                rom->name, x + offset, y + 2, FONT_MIDDLE_SIZE, color, prevSize.x - 5 - offset);
+                rom.name(), x + offset, y + 2, FONT_MIDDLE_SIZE, color, prevSize.x - 5 - offset);
         }
 
         gui.render_multicolor_text(
-            {{"Time: ", cfg.unselect_color}, {rom->total_time, color},
-                {"  Count: ", cfg.unselect_color}, {std::to_string(rom->count), color},
-                {"  Last: ", cfg.unselect_color}, {rom->last, color}},
+            {{"Time: ", cfg.unselect_color}, {utils::stringifyTime(live_time(rom)), color},
+                {"  Count: ", cfg.unselect_color}, {std::to_string(rom.count()), color},
+                {"  Last: ", cfg.unselect_color}, {rom.last(), color}},
             x + 15, y + prevSize.y / 2 + 6, FONT_TINY_SIZE);
 
         y += prevSize.y + 8;
     }
     if (list_size && gui.Width == 1280 && selected_index < filtered_roms_list.size()) {
         gui.render_image(cfg.theme_path + "skin/ic-game-580.png", 1070, 370, 400, 580);
-        gui.render_image(filtered_roms_list[selected_index]->image, 1070, 370, 400, 0);
+        gui.render_image(Rom(filtered_roms_list[selected_index]).get_image(), 1070, 370, 400, 0);
     }
 
     gui.render_image(cfg.theme_path + "skin/tips-bar-bg.png", gui.Width / 2, gui.Height - 20,
@@ -418,8 +468,7 @@ void Activities::game_list()
         // Make sure filtered_roms_list is not empty before accessing selected_index
         const bool has_rom =
             !filtered_roms_list.empty() && selected_index < filtered_roms_list.size();
-        std::vector<Rom>::iterator rom =
-            has_rom ? filtered_roms_list[selected_index] : roms_list.end();
+        Rom rom(has_rom ? filtered_roms_list[selected_index] : RomHandle());
         switch (action) {
         case InputAction::Quit: is_running = false; break;
         case InputAction::Up: {
@@ -469,8 +518,8 @@ void Activities::game_list()
         case InputAction::Y: {
             if (has_rom) {
                 upHolding = downHolding = false;
-                rom->start();
-                handle_game_return(rom->wait());
+                rom.start();
+                handle_game_return(rom.wait());
             }
             break;
         }
@@ -481,10 +530,10 @@ void Activities::game_list()
             gui.reset_scroll();
             break;
         case InputAction::ZR:
-            if (has_rom && !rom->manual.empty()) {
+            if (has_rom && !rom.get_manual().empty()) {
                 upHolding = downHolding = false;
-                // game_runner.start_external(std::string(MANUAL_READER) + " \"" + rom->manual +
-                // "\"");
+                // game_runner.start_external(std::string(MANUAL_READER) + " \"" +
+                // rom.get_manual() + "\"");
             }
             break;
         //
@@ -505,7 +554,8 @@ void Activities::game_list()
         case InputAction::Select: upHolding = downHolding = false; break;
         case InputAction::Start:
             upHolding = downHolding = false;
-            game_menu(rom);
+            if (has_rom)
+                game_menu(rom);
             break;
         default: break;
         }
@@ -535,6 +585,78 @@ void Activities::game_list()
         gui.reset_scroll();
 }
 
+// Total time of `rom` with the part of its running session not yet in DB.
+int Activities::live_time(Rom rom) const
+{
+    std::optional<LiveSession> live = LiveSessions::getInstance().find(rom.file());
+    return rom.time() + (live ? static_cast<int>(live->elapsed_ms / 1000) : 0);
+}
+
+void Activities::load_stats_details(Rom rom)
+{
+    stats_file = rom.file();
+    stats_details.clear();
+    load_activity_details(rom);
+    load_profile_details(rom);
+    load_latency_details(rom);
+}
+
+/**
+ * @brief Formats the resources used by the sessions of `rom` and of its system: CPU of one core
+ * while running, highest peak RSS and storage read per session.
+ */
+void Activities::load_profile_details(Rom rom)
+{
+    auto format = [](const ProfileStats& stats) {
+        std::string value = stats.cpu_percent != -1
+                                ? "CPU " + std::to_string(stats.cpu_percent) + "%"
+                                : "CPU N/A";
+        if (stats.peak_rss_kb != -1)
+            value += ", " + std::to_string(stats.peak_rss_kb / 1024) + " MB RAM";
+        if (stats.read_kb != -1)
+            value += ", " + std::to_string(stats.read_kb / 1024) + " MB read";
+        return value;
+    };
+    ProfileStats system = db.load_profile_stats(rom.system());
+    if (!system.sessions)
+        return;
+    ProfileStats game = db.load_profile_stats(rom.system(), rom.file());
+    stats_details.push_back({"Resources: ", game.sessions ? format(game) : "N/A"});
+    stats_details.push_back({rom.system() + ": ", format(system)});
+}
+
+/**
+ * @brief Formats the median launch and resume latencies of `rom` along with the median and 95th
+ * percentile of its system, for the detail view.
+ */
+void Activities::load_latency_details(Rom rom)
+{
+    auto seconds = [](int ms) {
+        char str[16];
+        snprintf(str, sizeof(str), "%.1f s", ms / 1000.0);
+        return std::string(str);
+    };
+    for (bool resume : {false, true}) {
+        std::vector<int> game = db.load_latencies(rom.system(), resume, rom.file());
+        std::vector<int> system = db.load_latencies(rom.system(), resume);
+        if (system.empty())
+            continue;
+        std::string value = game.empty() ? "N/A" : seconds(game[game.size() / 2]);
+        value += " (" + rom.system() + " " + seconds(system[system.size() / 2]) + " / p95 " +
+                 seconds(system[(system.size() - 1) * 95 / 100]) + ")";
+        stats_details.push_back({resume ? "Resume: " : "Launch: ", value});
+    }
+}
+
+// Formats the time `rom` was played and idle, if timed with idle tracking.
+void Activities::load_activity_details(Rom rom)
+{
+    int active, idle;
+    if (db.load_activity(rom.file(), active, idle))
+        stats_details.push_back({"Active time: ",
+            utils::stringifyTime(active) + " (idle " + utils::stringifyTime(idle) + ")"});
+}
+
 void Activities::game_detail()
 {
     // Safety check
@@ -553,13 +675,20 @@ void Activities::game_detail()
         }
     }
 
-    std::vector<Rom>::iterator rom = filtered_roms_list[selected_index];
+    Rom rom(filtered_roms_list[selected_index]);
+
+    // Resolve neighbours assets ahead of Left/Right navigation.
+    if (selected_index > 0)
+        Rom(filtered_roms_list[selected_index - 1]).prefetch();
+    if (selected_index + 1 < filtered_roms_list.size())
+        Rom(filtered_roms_list[selected_index + 1]).prefetch();
+    Readahead::getInstance().hover(rom.pid() == -1 ? rom.file() : "");
 
     // Header: Game name
     gui.render_image(cfg.theme_path + "skin/title-bg.png", gui.Width / 2, FONT_MIDDLE_SIZE,
         gui.Width, 2 * FONT_MIDDLE_SIZE);
     int offset = 10;
-    if (rom->pid != -1)
+    if (rom.pid() != -1)
         offset += gui.render_image(std::string(APP_DIR) + "/.assets/green_dot.svg",
                          offset + FONT_MIDDLE_SIZE / 2, offset + FONT_MIDDLE_SIZE / 2,
                          FONT_MIDDLE_SIZE * 1.5, FONT_MIDDLE_SIZE * 1.5, IMG_CENTER)
@@ -567,7 +696,7 @@ void Activities::game_detail()
                   offset;
 
     gui.render_scrollable_text(
-        rom->name, offset, 0, gui.Width - 2 * 10, FONT_MIDDLE_SIZE, cfg.unselect_color);
+        rom.name(), offset, 0, gui.Width - 2 * 10, FONT_MIDDLE_SIZE, cfg.unselect_color);
 
     // Left side: Rom image (reduced size)
     int frameWidth = gui.Width / 2 - 120;  // reduced
@@ -576,9 +705,9 @@ void Activities::game_detail()
     int frameY = gui.Height / 2 - 30; // slightly adjusted upward
     gui.render_image(
         cfg.theme_path + "skin/bg-menu-09.png", frameX, frameY, frameWidth, frameHeight);
-    if (!rom->image.empty()) {
+    if (!rom.get_image().empty()) {
         int innerW = frameWidth - 40;
-        gui.render_image(rom->image, frameX, frameY, 0, innerW, IMG_FIT | IMG_CENTER);
+        gui.render_image(rom.get_image(), frameX, frameY, 0, innerW, IMG_FIT | IMG_CENTER);
     } else {
         gui.render_image(cfg.theme_path + "skin/ic-keymap-n.png", frameX, frameY);
     }
@@ -619,13 +748,33 @@ void Activities::game_detail()
 
     // Right side: Game details
     std::vector<std::pair<std::string, std::string>> details = {
-        {"Total Time: ", rom->total_time.empty() ? "N/A" : rom->total_time},
-        {"Average Time: ", rom->average_time.empty() ? "N/A" : rom->average_time},
-        {"Last played: ", rom->last.empty() ? "N/A" : rom->last},
-        {"Last session: ", utils::stringifyTime(rom->lastsessiontime)},
-        {"Play count: ", std::to_string(rom->count)},
-        {"System: ", rom->system.empty() ? "N/A" : rom->system},
-        {"Completed: ", rom->completed ? "Yes" : "No"}, {"Launcher: ", rom->launcher}};
+        {"Total Time: ", utils::stringifyTime(live_time(rom))},
+        {"Average Time: ", rom.average_time().empty() ? "N/A" : rom.average_time()},
+        {"Last played: ", rom.last().empty() ? "N/A" : rom.last()},
+        {"Last session: ", utils::stringifyTime(rom.lastsessiontime())},
+        {"Play count: ", std::to_string(rom.count())},
+        {"System: ", rom.system().empty() ? "N/A" : rom.system()},
+        {"Completed: ", rom.completed() ? "Yes" : "No"}, {"Launcher: ", rom.get_launcher()}};
+    // Session timed by the daemon, counting live
+    std::optional<LiveSession> live = LiveSessions::getInstance().find(rom.file());
+    if (live) {
+        char   started[8];
+        time_t start_time = live->start_time;
+        strftime(started, sizeof(started), "%H:%M", localtime(&start_time));
+        details.push_back({"Current session: ",
+            utils::stringifyTime(live->elapsed_ms / 1000) + " since " + started +
+                (live->suspended ? " (suspended)" : "")});
+    }
+    // Resources of the running game, from its cgroup
+    long memory = rom.memory_current();
+    if (memory != -1)
+        details.push_back({"Memory: ", std::to_string(memory / (1024 * 1024)) + " MB"});
+    long cpu_usage = rom.cpu_usage_usec();
+    if (cpu_usage != -1)
+        details.push_back({"CPU time: ", utils::stringifyTime(cpu_usage / 1000000)});
+    if (stats_file != rom.file())
+        load_stats_details(rom);
+    details.insert(details.end(), stats_details.begin(), stats_details.end());
     gui.infos_window("Informations", FONT_TINY_SIZE, details, FONT_MINI_SIZE,
         3 * gui.Width / 4 - 10, gui.Height / 2, gui.Width / 2 - 50, gui.Height / 2);
 
@@ -636,7 +785,7 @@ void Activities::game_detail()
     gui.render_text(
         "File:", 50, gui.Height - FONT_MINI_SIZE * 4.5 + 4, FONT_MINI_SIZE, cfg.selected_color);
     gui.render_text(
-        rom->file, 100, gui.Height - FONT_MINI_SIZE * 4.5 + 4, FONT_MINI_SIZE, cfg.info_color);
+        rom.file(), 100, gui.Height - FONT_MINI_SIZE * 4.5 + 4, FONT_MINI_SIZE, cfg.info_color);
 
     gui.render_image(cfg.theme_path + "skin/tips-bar-bg.png", gui.Width / 2, gui.Height - 20,
         gui.Width, FONT_MINI_SIZE * 2);
@@ -671,7 +820,7 @@ void Activities::game_detail()
     }
 
     // Y now runs the game; remove Y Video hint
-    if (!rom->manual.empty())
+    if (!rom.get_manual().empty())
         gui.display_keybind("X", "Manual", gui.Width - 125);
 
     size_t    prev_selected_index = selected_index;
@@ -709,13 +858,13 @@ void Activities::game_detail()
         case InputAction::Y:
             // Y runs the game now (same as A)
             leftHolding = rightHolding = false;
-            rom->start();
-            handle_game_return(rom->wait());
+            rom.start();
+            handle_game_return(rom.wait());
             break;
         case InputAction::ZL:
-            if (!rom->video.empty()) {
+            if (!rom.get_video().empty()) {
                 leftHolding = rightHolding = false;
-                // game_runner.start_external(std::string(VIDEO_PLAYER) + " \"" + rom->video +
+                // game_runner.start_external(std::string(VIDEO_PLAYER) + " \"" + rom.get_video() +
                 // "\"");
             }
             break;
@@ -724,10 +873,10 @@ void Activities::game_detail()
             leftHolding = rightHolding = false;
             break;
         case InputAction::ZR:
-            if (!rom->manual.empty()) {
+            if (!rom.get_manual().empty()) {
                 leftHolding = rightHolding = false;
-                // game_runner.start_external(std::string(MANUAL_READER) + " \"" + rom->manual +
-                // "\"");
+                // game_runner.start_external(std::string(MANUAL_READER) + " \"" +
+                // rom.get_manual() + "\"");
             }
             break;
         case InputAction::Menu:
@@ -778,10 +927,12 @@ void Activities::overall_stats()
         int              count = 0;
         int              completed = 0;
         int              time = 0;
-        for (const auto& rom : roms_list) {
-            count += rom.count;
-            time += rom.time;
-            completed += rom.completed;
+        for (RomTable::Row row = 0; row < roms_list.rows(); row++) {
+            if (!roms_list.alive(row))
+                continue;
+            count += roms_list.count[row];
+            time += roms_list.time[row];
+            completed += roms_list.completed[row];
         }
         std::vector<std::pair<std::string, std::string>> content = {
             {"Total games: ", std::to_string(roms_list.size())},
@@ -820,26 +971,27 @@ void Activities::empty_db()
 
 void Activities::refresh_db(std::string selected_rom_file)
 {
+    stats_file.clear(); // the DB may have new statistics
     // Save the current selected rom file (if any)
     if (selected_rom_file.empty()) {
-        filter_roms(); // refresh filtered to avoid iterators invalids if a rom was added to
-                       // roms_list.
-        if (!filtered_roms_list.empty() && selected_index < filtered_roms_list.size())
-            selected_rom_file = filtered_roms_list[selected_index]->file;
+        if (selected_index < filtered_roms_list.size() &&
+            roms_list.valid(filtered_roms_list[selected_index]))
+            selected_rom_file = Rom(filtered_roms_list[selected_index]).file();
     } else {
         selected_rom_file = utils::shorten_file_path(selected_rom_file);
         if (!Rom::get(selected_rom_file)) {
             std::cout << "ROM not found in database, creating new entry for: " << selected_rom_file
                       << std::endl;
-            Rom(selected_rom_file).save();
+            Rom::add(selected_rom_file);
         }
     }
 
     Rom::refresh();
 
     std::set<std::string> unique_systems;
-    for (const auto& rom : roms_list) {
-        unique_systems.insert(rom.system);
+    for (RomTable::Row row = 0; row < roms_list.rows(); row++) {
+        if (roms_list.alive(row))
+            unique_systems.insert(roms_list.systems.get(roms_list.system[row]));
     }
     systems.clear();
     systems.push_back("All");
@@ -847,7 +999,7 @@ void Activities::refresh_db(std::string selected_rom_file)
     filter_roms();
     // Restore selection to the same rom if possible
     for (size_t i = 0; i < filtered_roms_list.size(); i++) {
-        if (filtered_roms_list[i]->file == selected_rom_file) {
+        if (roms_list.str(roms_list.file[filtered_roms_list[i].row]) == selected_rom_file) {
             selected_index = i;
             break;
         }
@@ -858,17 +1010,17 @@ void Activities::refresh_db(std::string selected_rom_file)
     std::cout << "db_refreshed !! Selected_index: " << selected_index << std::endl;
     // Debug: display loaded values
     if (selected_index < filtered_roms_list.size()) {
-        std::vector<Rom>::iterator loaded_rom = filtered_roms_list[selected_index];
+        Rom loaded_rom(filtered_roms_list[selected_index]);
         std::cout << "Final ROM data:" << std::endl;
-        std::cout << "  Name: " << loaded_rom->name << std::endl;
-        std::cout << "  File: " << loaded_rom->file << std::endl;
-        std::cout << "  Count: " << loaded_rom->count << std::endl;
-        std::cout << "  Time: " << loaded_rom->time << std::endl;
-        std::cout << "  Total time: '" << loaded_rom->total_time << "'" << std::endl;
-        std::cout << "  Average time: '" << loaded_rom->average_time << "'" << std::endl;
-        std::cout << "  System: '" << loaded_rom->system << "'" << std::endl;
-        std::cout << "  Launcher: '" << loaded_rom->launcher << "'" << std::endl;
-        std::cout << "  Last: '" << loaded_rom->last << "'" << std::endl;
+        std::cout << "  Name: " << loaded_rom.name() << std::endl;
+        std::cout << "  File: " << loaded_rom.file() << std::endl;
+        std::cout << "  Count: " << loaded_rom.count() << std::endl;
+        std::cout << "  Time: " << loaded_rom.time() << std::endl;
+        std::cout << "  Total time: '" << loaded_rom.total_time() << "'" << std::endl;
+        std::cout << "  Average time: '" << loaded_rom.average_time() << "'" << std::endl;
+        std::cout << "  System: '" << loaded_rom.system() << "'" << std::endl;
+        std::cout << "  Launcher: '" << loaded_rom.get_launcher() << "'" << std::endl;
+        std::cout << "  Last: '" << loaded_rom.last() << "'" << std::endl;
         std::cout << "  Selected index: " << selected_index << std::endl;
         std::cout << "  Total ROMs loaded: " << roms_list.size() << std::endl;
         std::cout << "  Filtered ROMs: " << filtered_roms_list.size() << std::endl;
@@ -958,44 +1110,110 @@ int               Activities::parseArgs(int argc, char** argv)
 
 void Activities::auto_resume()
 {
-    std::ifstream file("/mnt/SDCARD/Apps/Activities/data/autostarts.txt");
+    std::ifstream file(utils::instance_path(AUTOSTARTS_FILE));
     if (file.fail())
         return;
     std::cout << "\t Auto-resume games..." << std::endl;
     std::string       romFile;
-    std::vector<Rom*> ordered_roms;
+    std::vector<Rom> ordered_roms;
     while (std::getline(file, romFile)) {
         // Check if the ROM file exists before attempting to start it
 
         if (fs::exists(romFile)) {
-            Rom* rom_ptr = Rom::get(romFile);
+            std::optional<Rom> rom = Rom::get(romFile);
 
-            if (!rom_ptr) {
+            if (!rom) {
                 std::cout << "ROM " << romFile << " not found in DB, creating new entry."
                           << std::endl;
-                Rom rom(romFile);
-                rom_ptr = rom.save(); // Save the new ROM entry
+                rom = Rom::add(romFile); // Save the new ROM entry
             } else {
-                std::cout << "Found rom: " << rom_ptr->name << std::endl;
+                std::cout << "Found rom: " << rom->name() << std::endl;
             }
-            ordered_roms.push_back(rom_ptr);
+            ordered_roms.push_back(*rom);
         } else {
             std::cerr << "Autostart ROM file not found: " << romFile << std::endl;
         }
     }
+    if (ordered_roms.empty())
+        return;
 
     // sort games by last session date and stay on most recent one.
-    std::sort(
-        ordered_roms.begin(), ordered_roms.end(), [](Rom* a, Rom* b) { return a->last < b->last; });
-    for (auto rom_it = ordered_roms.begin(); rom_it < ordered_roms.end() - 1; rom_it++) {
-        (*rom_it)->start();
-        // Wait for the game to finish loading and update its PID
-        sleep(2);
-        (*rom_it)->suspend();
+    std::sort(ordered_roms.begin(), ordered_roms.end(), [this](const Rom& a, const Rom& b) {
+        return roms_list.last[a.get_handle().row] < roms_list.last[b.get_handle().row];
+    });
+
+    // Launch the others, up to resume_parallelism at once, and suspend each one as soon as it
+    // finished loading: once it opened its display or audio device and its CPU use settled.
+    struct Loading
+    {
+        Rom           rom;
+        Uint32        start;
+        Uint32        av_opened; // 0 until a display or audio device is opened
+        unsigned long ticks;
+        int           settled; // consecutive probes under resume_settle_percent
+    };
+    const Uint32        probe_ms = 100;
+    const unsigned long settle_ticks =
+        sysconf(_SC_CLK_TCK) * probe_ms * cfg.resume_settle_percent / 100000;
+    std::vector<Loading> loading;
+    auto                 next = ordered_roms.begin();
+    Uint32               resume_start = SDL_GetTicks();
+    while (next != ordered_roms.end() - 1 || !loading.empty()) {
+        while (next != ordered_roms.end() - 1 &&
+               loading.size() < static_cast<size_t>(cfg.resume_parallelism)) {
+            // Adopted from a previous GUI instance, already loaded and suspended
+            if (next->pid() != -1) {
+                std::cout << "\t " << next->name() << " already running" << std::endl;
+                next++;
+                continue;
+            }
+            next->start();
+            if (next->pid() != -1)
+                loading.push_back({*next, SDL_GetTicks(), 0, 0, 0});
+            next++;
+        }
+        SDL_Delay(probe_ms);
+
+        for (auto it = loading.begin(); it != loading.end();) {
+            pid_t         pid = it->rom.pid();
+            Uint32        now = SDL_GetTicks();
+            unsigned long ticks = utils::get_process_group_cpu_ticks(pid);
+            it->settled = ticks - it->ticks <= settle_ticks ? it->settled + 1 : 0;
+            it->ticks = ticks;
+            if (!it->av_opened && utils::process_group_uses_av_device(pid))
+                it->av_opened = now;
+
+            const char* reason = nullptr;
+            bool        exited = waitpid(pid, nullptr, WNOHANG) == pid;
+            if (exited)
+                reason = "exited";
+            else if (it->av_opened && (it->settled || now - it->av_opened >= 500))
+                reason = "device opened";
+            else if (ticks && it->settled >= 5)
+                reason = "cpu settled";
+            else if (now - it->start >= static_cast<Uint32>(cfg.resume_timeout_ms))
+                reason = "timeout";
+            if (!reason) {
+                it++;
+                continue;
+            }
+
+            if (exited)
+                it->rom.stop();
+            else
+                it->rom.suspend();
+            std::cout << "\t " << it->rom.name() << " restored in " << now - it->start << " ms ("
+                      << reason << ")" << std::endl;
+            it = loading.erase(it);
+        }
     }
+    if (ordered_roms.size() > 1)
+        std::cout << "\t " << ordered_roms.size() - 1 << " games restored in "
+                  << SDL_GetTicks() - resume_start << " ms" << std::endl;
+
     // Keep latest played game active.
-    ordered_roms.back()->start();
-    handle_game_return(ordered_roms.back()->wait());
+    ordered_roms.back().start();
+    handle_game_return(ordered_roms.back().wait());
 }
 
 void Activities::run(int argc, char** argv)
@@ -1010,12 +1228,21 @@ void Activities::run(int argc, char** argv)
         empty_db();
         sleep(5);
     }
+    // Locked by a running timer daemon, which recovers the journal itself
+    Journal& journal = Journal::getInstance();
+    if (journal.open(false)) {
+        if (journal.recover())
+            refresh_db();
+        journal.close();
+    }
+    Rom::adopt_orphans();
     if (auto_resume_enabled)
         auto_resume();
 
     while (is_running) {
-        if (db.is_refresh_needed())
+        if (LiveSessions::getInstance().poll() && db.is_refresh_needed())
             refresh_db();
+        Rom::remove_cgroups();
         // Safety check to avoid out-of-bounds access
         std::string current_system = "All";
         if (!systems.empty() && system_index < systems.size())
@@ -1,5 +1,6 @@
 #include "Config.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 
@@ -47,6 +48,89 @@ Config::Config()
         std::cerr << "Error: Could no open /mnt/SDCARD/System/etc/crossmix.json" << std::endl;
         exit(1);
     }
+
+    load_settings();
+}
+
+static std::string trim(const std::string& str)
+{
+    size_t first = str.find_first_not_of(" \t\r");
+    if (first == std::string::npos)
+        return "";
+    return str.substr(first, str.find_last_not_of(" \t\r") - first + 1);
+}
+
+/**
+ * @brief Loads the `key=value` settings of CONFIG_FILE.
+ *
+ * @details Empty lines and lines starting with '#' or ';' are ignored. Missing file or keys
+ * keep the defaults.
+ */
+void Config::load_settings()
+{
+    std::ifstream file(CONFIG_FILE);
+    std::string   line;
+    while (std::getline(file, line)) {
+        line = trim(line);
+        size_t sep = line.find('=');
+        if (line.empty() || line[0] == '#' || line[0] == ';' || sep == std::string::npos)
+            continue;
+        settings[trim(line.substr(0, sep))] = trim(line.substr(sep + 1));
+    }
+
+    background_release_renderer =
+        get_bool_setting("background_release_renderer", background_release_renderer);
+    text_cache_budget_mb = get_int_setting("text_cache_budget_mb", text_cache_budget_mb);
+    resume_parallelism = std::max(1, get_int_setting("resume_parallelism", resume_parallelism));
+    resume_timeout_ms = get_int_setting("resume_timeout_ms", resume_timeout_ms);
+    resume_settle_percent = get_int_setting("resume_settle_percent", resume_settle_percent);
+    suspended_memory_budget_mb =
+        get_int_setting("suspended_memory_budget_mb", suspended_memory_budget_mb);
+    retroarch_cmd_port = get_int_setting("retroarch_cmd_port", retroarch_cmd_port);
+    suspend_pageout = get_bool_setting("suspend_pageout", suspend_pageout);
+    use_cgroups = get_bool_setting("use_cgroups", use_cgroups);
+    cgroup_root = get_setting("cgroup_root", cgroup_root);
+    use_posix_spawn = get_bool_setting("use_posix_spawn", use_posix_spawn);
+    game_nice = get_int_setting("game_nice", game_nice);
+    game_cpus = get_setting("game_cpus", game_cpus);
+    gui_nice = get_int_setting("gui_nice", gui_nice);
+    gui_cpus = get_setting("gui_cpus", gui_cpus);
+    helper_processes = get_setting("helper_processes", helper_processes);
+    readahead_dwell_ms = get_int_setting("readahead_dwell_ms", readahead_dwell_ms);
+    readahead_budget_mb = get_int_setting("readahead_budget_mb", readahead_budget_mb);
+    latency_timeout_ms = get_int_setting("latency_timeout_ms", latency_timeout_ms);
+    checkpoint_minutes = get_int_setting("checkpoint_minutes", checkpoint_minutes);
+    idle_timeout_s = get_int_setting("idle_timeout_s", idle_timeout_s);
+    idle_cpu_percent = get_int_setting("idle_cpu_percent", idle_cpu_percent);
+    cpufreq_root = get_setting("cpufreq_root", cpufreq_root);
+    battery_path = get_setting("battery_path", battery_path);
+}
+
+std::string Config::get_setting(const std::string& key, const std::string& fallback) const
+{
+    auto it = settings.find(key);
+    return it == settings.end() ? fallback : it->second;
+}
+
+int Config::get_int_setting(const std::string& key, int fallback) const
+{
+    auto it = settings.find(key);
+    if (it == settings.end())
+        return fallback;
+    try {
+        return std::stoi(it->second);
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid value for " << key << ": " << it->second << std::endl;
+        return fallback;
+    }
+}
+
+bool Config::get_bool_setting(const std::string& key, bool fallback) const
+{
+    auto it = settings.find(key);
+    if (it == settings.end())
+        return fallback;
+    return it->second == "1" || it->second == "true" || it->second == "on";
 }
 
 bool Config::load_theme(const std::string& filePath)
@@ -1,14 +1,19 @@
 #include "DB.h"
 
+#include "utils.h"
+
 #include <iostream>
 
 DB::DB()
     : db(nullptr)
 {
 
-    if (sqlite3_open(DB_FILE, &db) != SQLITE_OK) {
+    db_file = utils::instance_path(DB_FILE);
+    if (sqlite3_open(db_file.c_str(), &db) != SQLITE_OK) {
         std::cerr << "Error opening SQLite database: " << sqlite3_errmsg(db) << std::endl;
     }
+    // The timer daemon holds its writes in a transaction for a while, the GUI reads meanwhile
+    sqlite3_busy_timeout(db, DB_BUSY_TIMEOUT_MS);
     std::string query = "CREATE TABLE IF NOT EXISTS games_datas ("
                         "file TEXT PRIMARY KEY NOT NULL,"
                         "name TEXT NOT NULL,"
@@ -24,6 +29,41 @@ DB::DB()
         std::cerr << "Error creating table: " << err_msg << std::endl;
         sqlite3_free(err_msg);
     }
+    // Time from launch or resume to the first frame of the game, in ms
+    query = "CREATE TABLE IF NOT EXISTS latencies ("
+            "file TEXT NOT NULL,"
+            "system TEXT NOT NULL,"
+            "resume INTEGER NOT NULL,"
+            "ms INTEGER NOT NULL"
+            ")";
+    if (sqlite3_exec(db, query.c_str(), nullptr, nullptr, &err_msg) != SQLITE_OK) {
+        std::cerr << "Error creating table: " << err_msg << std::endl;
+        sqlite3_free(err_msg);
+    }
+    // History of the sessions timed by the daemon with the resources they used
+    query = "CREATE TABLE IF NOT EXISTS sessions ("
+            "file TEXT NOT NULL,"
+            "system TEXT NOT NULL,"
+            "date INTEGER NOT NULL,"
+            "time INTEGER NOT NULL,"
+            "cpu_percent INTEGER,"
+            "peak_rss_kb INTEGER,"
+            "read_kb INTEGER"
+            ")";
+    if (sqlite3_exec(db, query.c_str(), nullptr, nullptr, &err_msg) != SQLITE_OK) {
+        std::cerr << "Error creating table: " << err_msg << std::endl;
+        sqlite3_free(err_msg);
+    }
+    // Part of the time of games timed with idle tracking spent playing or idle, in seconds
+    query = "CREATE TABLE IF NOT EXISTS activity ("
+            "file TEXT PRIMARY KEY NOT NULL,"
+            "active INTEGER NOT NULL,"
+            "idle INTEGER NOT NULL"
+            ")";
+    if (sqlite3_exec(db, query.c_str(), nullptr, nullptr, &err_msg) != SQLITE_OK) {
+        std::cerr << "Error creating table: " << err_msg << std::endl;
+        sqlite3_free(err_msg);
+    }
 }
 
 DB::~DB()
@@ -205,3 +245,211 @@ void DB::remove(const std::string& file)
 
     sqlite3_finalize(stmt);
 }
+
+/**
+ * @brief Groups the following writes in a single transaction, until `commit`.
+ *
+ * @details The write lock is taken at once (BEGIN IMMEDIATE), waiting for the other process if
+ * needed, rather than at the first write, which could then fail with SQLITE_BUSY.
+ *
+ * @return false if no transaction was started, the writes then being committed one by one.
+ */
+bool DB::begin()
+{
+    char* err_msg = nullptr;
+    if (!db || sqlite3_exec(db, "BEGIN IMMEDIATE", nullptr, nullptr, &err_msg) != SQLITE_OK) {
+        std::cerr << "Error beginning transaction: " << (err_msg ? err_msg : "no database")
+                  << std::endl;
+        sqlite3_free(err_msg);
+        return false;
+    }
+    return true;
+}
+
+// Returns false if the transaction is still open, readers holding the DB too long: to retry.
+bool DB::commit()
+{
+    char* err_msg = nullptr;
+    if (!db || sqlite3_exec(db, "COMMIT", nullptr, nullptr, &err_msg) != SQLITE_OK) {
+        std::cerr << "Error committing transaction: " << (err_msg ? err_msg : "no database")
+                  << std::endl;
+        sqlite3_free(err_msg);
+        return false;
+    }
+    return true;
+}
+
+void DB::save_latency(const std::string& file, const std::string& system, bool resume, int ms)
+{
+    if (!db) {
+        std::cerr << "No connection to SQLite database." << std::endl;
+        return;
+    }
+
+    std::string   query = "INSERT INTO latencies (file, system, resume, ms) VALUES (?, ?, ?, ?)";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Error preparing INSERT query: " << sqlite3_errmsg(db) << std::endl;
+        return;
+    }
+
+    sqlite3_bind_text(stmt, 1, file.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, system.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 3, resume);
+    sqlite3_bind_int(stmt, 4, ms);
+
+    if (sqlite3_step(stmt) != SQLITE_DONE)
+        std::cerr << "Error inserting latency: " << sqlite3_errmsg(db) << std::endl;
+
+    sqlite3_finalize(stmt);
+}
+
+// Latencies of the launches (or resumes) of `system`, or only of `file` if given, sorted.
+std::vector<int> DB::load_latencies(
+    const std::string& system, bool resume, const std::string& file)
+{
+    std::vector<int> latencies;
+    if (!db)
+        return latencies;
+
+    std::string query = "SELECT ms FROM latencies WHERE system = ? AND resume = ?";
+    if (!file.empty())
+        query += " AND file = ?";
+    query += " ORDER BY ms";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Error preparing SELECT query: " << sqlite3_errmsg(db) << std::endl;
+        return latencies;
+    }
+
+    sqlite3_bind_text(stmt, 1, system.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 2, resume);
+    if (!file.empty())
+        sqlite3_bind_text(stmt, 3, file.c_str(), -1, SQLITE_STATIC);
+
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+        latencies.push_back(sqlite3_column_int(stmt, 0));
+    sqlite3_finalize(stmt);
+    return latencies;
+}
+
+// Adds `active` and `idle` seconds to those of `file`.
+void DB::save_activity(const std::string& file, int active, int idle)
+{
+    if (!db) {
+        std::cerr << "No connection to SQLite database." << std::endl;
+        return;
+    }
+
+    const char* queries[] = {"INSERT OR IGNORE INTO activity (file, active, idle) VALUES (?, 0, 0)",
+        "UPDATE activity SET active = active + ?, idle = idle + ? WHERE file = ?"};
+    for (const char* query : queries) {
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, query, -1, &stmt, nullptr) != SQLITE_OK) {
+            std::cerr << "Error preparing activity query: " << sqlite3_errmsg(db) << std::endl;
+            return;
+        }
+        if (sqlite3_bind_parameter_count(stmt) == 1) {
+            sqlite3_bind_text(stmt, 1, file.c_str(), -1, SQLITE_STATIC);
+        } else {
+            sqlite3_bind_int(stmt, 1, active);
+            sqlite3_bind_int(stmt, 2, idle);
+            sqlite3_bind_text(stmt, 3, file.c_str(), -1, SQLITE_STATIC);
+        }
+        if (sqlite3_step(stmt) != SQLITE_DONE)
+            std::cerr << "Error saving activity: " << sqlite3_errmsg(db) << std::endl;
+        sqlite3_finalize(stmt);
+    }
+}
+
+// Active and idle seconds of `file`, false if it was never timed with idle tracking.
+bool DB::load_activity(const std::string& file, int& active, int& idle)
+{
+    if (!db)
+        return false;
+
+    std::string   query = "SELECT active, idle FROM activity WHERE file = ?";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Error preparing SELECT query: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+
+    sqlite3_bind_text(stmt, 1, file.c_str(), -1, SQLITE_STATIC);
+    bool found = sqlite3_step(stmt) == SQLITE_ROW;
+    if (found) {
+        active = sqlite3_column_int(stmt, 0);
+        idle = sqlite3_column_int(stmt, 1);
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+// Adds a session of `time` seconds ending now to the history, unknown resources left NULL.
+void DB::save_profile(
+    const std::string& file, const std::string& system, int time, const SessionProfile& profile)
+{
+    if (!db) {
+        std::cerr << "No connection to SQLite database." << std::endl;
+        return;
+    }
+
+    std::string query = "INSERT INTO sessions (file, system, date, time, cpu_percent, peak_rss_kb, "
+                        "read_kb) VALUES (?, ?, strftime('%s', 'now'), ?, ?, ?, ?)";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Error preparing INSERT query: " << sqlite3_errmsg(db) << std::endl;
+        return;
+    }
+
+    sqlite3_bind_text(stmt, 1, file.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, system.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 3, time);
+    if (profile.cpu_percent != -1)
+        sqlite3_bind_int(stmt, 4, profile.cpu_percent);
+    if (profile.peak_rss_kb != -1)
+        sqlite3_bind_int64(stmt, 5, profile.peak_rss_kb);
+    if (profile.read_kb != -1)
+        sqlite3_bind_int64(stmt, 6, profile.read_kb);
+
+    if (sqlite3_step(stmt) != SQLITE_DONE)
+        std::cerr << "Error inserting session: " << sqlite3_errmsg(db) << std::endl;
+
+    sqlite3_finalize(stmt);
+}
+
+// Resources used by the sessions of `system`, or only of `file` if given.
+ProfileStats DB::load_profile_stats(const std::string& system, const std::string& file)
+{
+    ProfileStats stats = {0, -1, -1, -1};
+    if (!db)
+        return stats;
+
+    std::string query = "SELECT COUNT(*), SUM(cpu_percent * time) / "
+                        "SUM(CASE WHEN cpu_percent IS NULL THEN 0 ELSE time END), "
+                        "MAX(peak_rss_kb), AVG(read_kb) FROM sessions WHERE system = ?";
+    if (!file.empty())
+        query += " AND file = ?";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Error preparing SELECT query: " << sqlite3_errmsg(db) << std::endl;
+        return stats;
+    }
+
+    sqlite3_bind_text(stmt, 1, system.c_str(), -1, SQLITE_STATIC);
+    if (!file.empty())
+        sqlite3_bind_text(stmt, 2, file.c_str(), -1, SQLITE_STATIC);
+
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        stats.sessions = sqlite3_column_int(stmt, 0);
+        // NULL when no session had that resource known
+        if (sqlite3_column_type(stmt, 1) != SQLITE_NULL)
+            stats.cpu_percent = sqlite3_column_int(stmt, 1);
+        if (sqlite3_column_type(stmt, 2) != SQLITE_NULL)
+            stats.peak_rss_kb = sqlite3_column_int64(stmt, 2);
+        if (sqlite3_column_type(stmt, 3) != SQLITE_NULL)
+            stats.read_kb = sqlite3_column_int64(stmt, 3);
+    }
+    sqlite3_finalize(stmt);
+    return stats;
+}
@@ -5,10 +5,15 @@
 #include <fcntl.h>
 #include <iostream>
 #include <linux/fb.h>
+#ifdef __GLIBC__
+#    include <malloc.h>
+#endif
 #include <map>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 
+#define RENDERER_FLAGS (SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC)
+
 GUI::GUI()
     : cfg(Config::getInstance())
 {
@@ -36,7 +41,7 @@ int GUI::init()
         return -1;
     }
 
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    renderer = SDL_CreateRenderer(window, -1, RENDERER_FLAGS);
     if (!renderer) {
         std::cerr << "Renderer could not be created! SDL_Error: " << SDL_GetError() << std::endl;
         SDL_DestroyWindow(window);
@@ -67,10 +72,11 @@ GUI::~GUI()
             SDL_DestroyTexture(texture.second.texture);
     image_cache.clear();
 
-    for (auto& entry : cached_text)
+    for (auto& entry : text_lru)
         if (entry.texture)
             SDL_DestroyTexture(entry.texture);
-    cached_text.clear();
+    text_lru.clear();
+    text_index.clear();
 
     delete_background_texture();
 
@@ -83,6 +89,98 @@ GUI::~GUI()
     SDL_Quit();
 }
 
+// Name of the opened joystick, empty if none.
+std::string GUI::joystick_name() const
+{
+    const char* name = joystick ? SDL_JoystickName(joystick) : nullptr;
+    return name ? name : "";
+}
+
+/**
+ * @brief Releases the GUI resources while a game runs in the foreground.
+ *
+ * @details Destroys every cached image and text texture, the background texture and closes the
+ * fonts, then gives the freed heap back to the system. With `background_release_renderer` the
+ * renderer itself is destroyed too. Only the paths of the images drawn in the last frame are
+ * kept, so `leave_background` can reload them at once and redraw the previous screen in the
+ * next frame. Calling it again while already in background does nothing.
+ *
+ * @return The number of texture bytes freed.
+ */
+size_t GUI::enter_background()
+{
+    if (in_background)
+        return 0;
+
+    size_t freed = 0;
+    restore_images.clear();
+    for (auto& entry : image_cache) {
+        if (!entry.second.texture)
+            continue;
+        if (entry.second.last_frame + 1 >= frame)
+            restore_images.push_back(entry.first);
+        freed += static_cast<size_t>(entry.second.width) * entry.second.height * 4;
+        SDL_DestroyTexture(entry.second.texture);
+    }
+    std::unordered_map<std::string, CachedImg>().swap(image_cache);
+
+    for (auto& entry : text_lru)
+        if (entry.texture)
+            SDL_DestroyTexture(entry.texture);
+    freed += text_bytes;
+    text_lru.clear();
+    std::unordered_map<Text, std::list<CachedText>::iterator, TextHash>().swap(text_index);
+    text_bytes = 0;
+
+    if (background_texture) {
+        freed += static_cast<size_t>(Width) * Height * 4;
+        delete_background_texture();
+    }
+
+    size_t fonts_count = fonts.size();
+    for (auto& font : fonts)
+        TTF_CloseFont(font.second);
+    fonts.clear();
+
+    if (cfg.background_release_renderer) {
+        SDL_DestroyRenderer(renderer);
+        renderer = nullptr;
+    }
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+
+    in_background = true;
+    std::cout << "GUI: background mode, " << freed << " texture bytes and " << fonts_count
+              << " fonts released" << (renderer ? "" : ", renderer destroyed") << ", text cache "
+              << text_hits << " hits and " << text_misses << " misses" << std::endl;
+    return freed;
+}
+
+/**
+ * @brief Leaves background mode, recreating the renderer if needed and reloading the images of
+ * the last frame displayed. Texts and fonts are recreated on demand by the next frame.
+ */
+void GUI::leave_background()
+{
+    if (!in_background)
+        return;
+    in_background = false;
+
+    Uint32 start = SDL_GetTicks();
+    if (!renderer) {
+        renderer = SDL_CreateRenderer(window, -1, RENDERER_FLAGS);
+        if (!renderer)
+            std::cerr << "Renderer could not be created! SDL_Error: " << SDL_GetError()
+                      << std::endl;
+    }
+    for (const std::string& image_path : restore_images)
+        load_image(image_path);
+    std::cout << "GUI: restored " << restore_images.size() << " images in "
+              << SDL_GetTicks() - start << " ms" << std::endl;
+    restore_images.clear();
+}
+
 void GUI::draw_green_dot(int x, int y, int radius)
 {
     SDL_SetRenderDrawColor(renderer, 0, 200, 0, 255); // vert
@@ -295,6 +393,7 @@ void GUI::clear()
 void GUI::render()
 {
     SDL_RenderPresent(renderer);
+    frame++;
 }
 
 /**
@@ -316,13 +415,10 @@ Vec2 GUI::render_image(const std::string& image_path, int x, int y, int w, int h
 {
     if (image_path.empty() || !fs::exists(image_path))
         return {0, 0};
-    if (image_cache.find(image_path) == image_cache.end()) {
-        SDL_Surface* surface = IMG_Load(image_path.c_str());
-        image_cache[image_path] = {
-            SDL_CreateTextureFromSurface(renderer, surface), surface->w, surface->h};
-        SDL_FreeSurface(surface);
-    }
-    CachedImg& cached_texture = image_cache[image_path];
+    CachedImg& cached_texture = load_image(image_path);
+    if (!cached_texture.texture)
+        return {0, 0};
+    cached_texture.last_frame = frame;
 
     int width = w;
     int height = h;
@@ -350,43 +446,83 @@ Vec2 GUI::render_image(const std::string& image_path, int x, int y, int w, int h
     return {width, height};
 }
 
+// Returns the cached texture of `image_path`, loading it first if needed.
+CachedImg& GUI::load_image(const std::string& image_path)
+{
+    auto it = image_cache.find(image_path);
+    if (it != image_cache.end())
+        return it->second;
+
+    CachedImg    cached;
+    SDL_Surface* surface = IMG_Load(image_path.c_str());
+    if (surface) {
+        cached = {SDL_CreateTextureFromSurface(renderer, surface), surface->w, surface->h, frame};
+        SDL_FreeSurface(surface);
+    } else {
+        std::cerr << "Failed to load " << image_path << ": " << IMG_GetError() << std::endl;
+    }
+    return image_cache[image_path] = cached;
+}
+
 /**
- * @brief Renders a cached text element.
+ * @brief Returns the texture of a text, rendering and caching it first if needed.
  *
- * @details This function retrieves a pre-rendered text texture from the cache or creates
- * it if it doesn't exist. It then draws the texture onto the SDL renderer at the
- * specified position. It handles text clipping if the rendered text exceeds a
- * given width.
+ * @details Texts are looked up by string, size and color in `text_index` and moved to the front
+ * of `text_lru` when drawn. A new text is rendered, put in front, then the least recently drawn
+ * ones are destroyed while the textures exceed `text_cache_budget_mb`. Texts of the frame being
+ * drawn are always kept, so a reference returned stays valid until the frame is rendered. A text
+ * that failed to render is cached too, without texture, not to retry it every frame.
  *
  * @param text The Text object containing the string, size, and color.
  * @return A reference to the CachedText object (either existing or newly created).
  */
 CachedText& GUI::getCachedText(const Text& text)
 {
-    for (auto& cached : cached_text) {
-        if (cached.text == text)
-            return cached;
+    auto it = text_index.find(text);
+    if (it != text_index.end()) {
+        text_hits++;
+        text_lru.splice(text_lru.begin(), text_lru, it->second);
+        it->second->last_frame = frame;
+        return *it->second;
     }
+    text_misses++;
 
-    TTF_Font* font = get_font(text.size);
-
-    SDL_Surface* surface = TTF_RenderText_Blended(font, text.str.c_str(), text.color);
+    CachedText   cached = {nullptr, 0, 0, text, frame};
+    TTF_Font*    font = get_font(text.size);
+    SDL_Surface* surface =
+        font ? TTF_RenderText_Blended(font, text.str.c_str(), text.color) : nullptr;
     if (!surface) {
         std::cerr << "Failed to render text: " << TTF_GetError() << std::endl;
-        TTF_CloseFont(font);
-    }
-
-    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-    if (!texture) {
+    } else {
+        cached.texture = SDL_CreateTextureFromSurface(renderer, surface);
+        if (cached.texture) {
+            cached.width = surface->w;
+            cached.height = surface->h;
+        } else {
+            std::cerr << "Failed to create texture: " << SDL_GetError() << std::endl;
+        }
         SDL_FreeSurface(surface);
-        std::cerr << "Failed to create texture: " << SDL_GetError() << std::endl;
     }
 
-    CachedText cached = {texture, surface->w, surface->h, text};
-    cached_text.push_back(cached);
+    text_lru.push_front(cached);
+    text_index[text] = text_lru.begin();
+    text_bytes += static_cast<size_t>(cached.width) * cached.height * 4;
+    evict_texts();
+    return text_lru.front();
+}
 
-    SDL_FreeSurface(surface);
-    return cached_text.back();
+// Destroys the least recently drawn texts beyond the budget, down to those of the current frame.
+void GUI::evict_texts()
+{
+    size_t budget = static_cast<size_t>(cfg.text_cache_budget_mb) << 20;
+    while (budget && text_bytes > budget && text_lru.back().last_frame != frame) {
+        CachedText& oldest = text_lru.back();
+        if (oldest.texture)
+            SDL_DestroyTexture(oldest.texture);
+        text_bytes -= static_cast<size_t>(oldest.width) * oldest.height * 4;
+        text_index.erase(oldest.text);
+        text_lru.pop_back();
+    }
 }
 
 /**
@@ -547,6 +683,7 @@ void GUI::reset_scroll()
  */
 void GUI::render_background(const std::string& system)
 {
+    leave_background();
     clear();
     if (background_texture) {
         SDL_RenderCopy(renderer, background_texture, nullptr, nullptr);
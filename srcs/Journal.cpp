@@ -0,0 +1,127 @@
+#include "Journal.h"
+
+#include "Rom.h"
+#include "utils.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define JOURNAL_SIZE (JOURNAL_SLOTS * sizeof(JournalSlot))
+
+Journal::Journal() {}
+
+Journal::~Journal()
+{
+    close();
+}
+
+/**
+ * @brief Maps the journal and takes its lock, waiting for it if `wait`.
+ *
+ * @return false if the journal is not available or, without `wait`, locked by a running daemon.
+ */
+bool Journal::open(bool wait)
+{
+    if (slots)
+        return true;
+    std::string file = utils::instance_path(JOURNAL_FILE);
+    fd = ::open(file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        std::cerr << "Journal: Could not open " << file << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    if (flock(fd, wait ? LOCK_EX : LOCK_EX | LOCK_NB) == -1) {
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    // Allocated once so checkpoints never have to grow the file
+    if (posix_fallocate(fd, 0, JOURNAL_SIZE) != 0 ||
+        (slots = static_cast<JournalSlot*>(
+             mmap(nullptr, JOURNAL_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0))) ==
+            MAP_FAILED) {
+        std::cerr << "Journal: Could not map " << file << std::endl;
+        slots = nullptr;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void Journal::close()
+{
+    if (slots)
+        munmap(slots, JOURNAL_SIZE);
+    if (fd != -1)
+        ::close(fd); // also releases the lock
+    slots = nullptr;
+    fd = -1;
+}
+
+/**
+ * @brief Saves in DB the sessions left in the journal by a timer that did not end them, then
+ * clears them.
+ *
+ * @return The number of sessions recovered.
+ */
+int Journal::recover()
+{
+    if (!slots)
+        return 0;
+    int recovered = 0;
+    for (int slot = 0; slot < JOURNAL_SLOTS; slot++) {
+        if (!slots[slot].in_use)
+            continue;
+        slots[slot].rom_file[sizeof(slots[slot].rom_file) - 1] = '\0';
+        std::cout << "Journal: Recovering " << slots[slot].seconds << " s of "
+                  << slots[slot].rom_file << std::endl;
+        if (slots[slot].seconds >= 30)
+            Rom::save_session(slots[slot].rom_file, slots[slot].seconds);
+        slots[slot].in_use = 0;
+        recovered++;
+    }
+    if (recovered)
+        sync();
+    return recovered;
+}
+
+// Takes a free slot for a session of `rom_file`, -1 if none is left.
+int Journal::acquire(const std::string& rom_file)
+{
+    if (!slots || rom_file.size() >= sizeof(slots[0].rom_file))
+        return -1;
+    for (int slot = 0; slot < JOURNAL_SLOTS; slot++) {
+        if (slots[slot].in_use)
+            continue;
+        strcpy(slots[slot].rom_file, rom_file.c_str());
+        slots[slot].seconds = 0;
+        slots[slot].in_use = 1;
+        return slot;
+    }
+    return -1;
+}
+
+// Records the time of a slot in memory, written to storage by the next `sync`.
+void Journal::checkpoint(int slot, long seconds)
+{
+    if (slots && slot >= 0 && slot < JOURNAL_SLOTS)
+        slots[slot].seconds = static_cast<uint32_t>(seconds);
+}
+
+void Journal::release(int slot)
+{
+    if (slots && slot >= 0 && slot < JOURNAL_SLOTS) {
+        slots[slot].in_use = 0;
+        sync();
+    }
+}
+
+void Journal::sync()
+{
+    if (slots && msync(slots, JOURNAL_SIZE, MS_SYNC) == -1)
+        std::cerr << "Journal: msync failed: " << strerror(errno) << std::endl;
+}
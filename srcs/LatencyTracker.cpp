@@ -0,0 +1,110 @@
+#include "LatencyTracker.h"
+
+#include <fcntl.h>
+#include <iostream>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+LatencyTracker::LatencyTracker()
+    : cfg(Config::getInstance())
+    , db(DB::getInstance())
+{
+}
+
+LatencyTracker::~LatencyTracker()
+{
+    end();
+}
+
+/**
+ * @brief FNV-1a hash of the center quarter of the visible framebuffer, one pixel out of four.
+ *
+ * @details The visible buffer is looked up on each call as the game may flip between several.
+ */
+uint64_t LatencyTracker::frame_hash() const
+{
+    struct fb_var_screeninfo vinfo;
+    if (ioctl(fb_fd, FBIOGET_VSCREENINFO, &vinfo) == -1)
+        return 0;
+    size_t bytes_per_pixel = vinfo.bits_per_pixel / 8;
+    size_t first_row = vinfo.yoffset + vinfo.yres * 3 / 8;
+    size_t first_column = vinfo.xoffset + vinfo.xres * 3 / 8;
+    if (!bytes_per_pixel || (first_row + vinfo.yres / 4) * finfo.line_length > finfo.smem_len)
+        return 0;
+
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t y = first_row; y < first_row + vinfo.yres / 4; y += 4) {
+        const uint8_t* row = static_cast<const uint8_t*>(fb_ptr) + y * finfo.line_length;
+        for (size_t x = first_column; x < first_column + vinfo.xres / 4; x += 4) {
+            for (size_t byte = 0; byte < bytes_per_pixel; byte++) {
+                hash ^= row[x * bytes_per_pixel + byte];
+                hash *= 1099511628211ULL;
+            }
+        }
+    }
+    return hash;
+}
+
+/**
+ * @brief Starts measuring the launch or resume of `rom`, to be called before it can draw.
+ */
+void LatencyTracker::begin(const Rom& rom, bool is_resume)
+{
+    end();
+    if (cfg.latency_timeout_ms <= 0)
+        return;
+    fb_fd = open("/dev/fb0", O_RDONLY | O_CLOEXEC);
+    if (fb_fd == -1)
+        return;
+    if (ioctl(fb_fd, FBIOGET_FSCREENINFO, &finfo) == -1 ||
+        (fb_ptr = mmap(0, finfo.smem_len, PROT_READ, MAP_SHARED, fb_fd, 0)) == MAP_FAILED) {
+        std::cerr << "LatencyTracker: Could not map framebuffer." << std::endl;
+        fb_ptr = nullptr;
+        end();
+        return;
+    }
+    handle = rom.get_handle();
+    resumed = is_resume;
+    baseline = frame_hash();
+    start = std::chrono::steady_clock::now();
+}
+
+void LatencyTracker::end()
+{
+    if (fb_ptr)
+        munmap(fb_ptr, finfo.smem_len);
+    if (fb_fd != -1)
+        close(fb_fd);
+    fb_ptr = nullptr;
+    fb_fd = -1;
+    handle = {};
+}
+
+/**
+ * @brief Checks whether `rom` drew a new frame since `begin`, saving the latency once it did.
+ *
+ * @return true while the measure of `rom` is still going on.
+ */
+bool LatencyTracker::sample(const Rom& rom)
+{
+    if (!fb_ptr || handle != rom.get_handle())
+        return false;
+
+    int elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start)
+                      .count();
+    if (frame_hash() != baseline) {
+        std::cout << "LatencyTracker: " << rom.name() << (resumed ? " resumed" : " launched")
+                  << " in " << elapsed << " ms" << std::endl;
+        db.save_latency(rom.file(), rom.system(), resumed, elapsed);
+        end();
+        return false;
+    }
+    if (elapsed > cfg.latency_timeout_ms) {
+        std::cout << "LatencyTracker: No new frame from " << rom.name() << " after " << elapsed
+                  << " ms" << std::endl;
+        end();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,182 @@
+#include "LiveSessions.h"
+
+#include "Timer.h"
+#include "utils.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <sys/mman.h>
+
+LiveSessions::LiveSessions() {}
+
+LiveSessions::~LiveSessions()
+{
+    if (!segment)
+        return;
+    if (writable) {
+        // Sessions still running are left to the journal, not to be shown as live anymore
+        for (int slot = 0; slot < LIVE_SLOTS; slot++)
+            release(slot);
+        segment->owner = 0;
+    }
+    munmap(segment, sizeof(Segment));
+}
+
+bool LiveSessions::map(bool write)
+{
+    std::string file = utils::instance_path(LIVE_FILE);
+    int         flags = write ? O_RDWR | O_CREAT | O_CLOEXEC : O_RDONLY | O_CLOEXEC;
+    int         fd = open(file.c_str(), flags, 0644);
+    if (fd == -1)
+        return false;
+    // The GUI only maps the segment once the daemon sized it
+    struct stat st;
+    bool        sized = write ? ftruncate(fd, sizeof(Segment)) == 0
+                              : fstat(fd, &st) == 0 && st.st_size >= (off_t) sizeof(Segment);
+    int         protection = write ? PROT_READ | PROT_WRITE : PROT_READ;
+    void*       address =
+        sized ? mmap(nullptr, sizeof(Segment), protection, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (address == MAP_FAILED)
+        return false;
+    segment = static_cast<Segment*>(address);
+    writable = write;
+    return true;
+}
+
+// Seqlock write: readers retry while the sequence is odd or changed under them.
+void LiveSessions::write(int slot, const Data& data)
+{
+    Slot&    entry = segment->slots[slot];
+    uint32_t sequence = entry.sequence.load(std::memory_order_relaxed);
+    entry.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&entry.data, &data, sizeof(Data));
+    entry.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+// Seqlock read, false if the writer kept the slot busy.
+bool LiveSessions::read(int slot, Data& data) const
+{
+    const Slot& entry = segment->slots[slot];
+    for (int tries = 0; tries < 100; tries++) {
+        uint32_t before = entry.sequence.load(std::memory_order_acquire);
+        if (before & 1)
+            continue;
+        memcpy(&data, &entry.data, sizeof(Data));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (entry.sequence.load(std::memory_order_relaxed) == before)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Maps LIVE_FILE for the daemon and clears the sessions a crashed daemon left.
+ */
+bool LiveSessions::create()
+{
+    if (!segment && !map(true)) {
+        std::cerr << "LiveSessions: Could not map " << utils::instance_path(LIVE_FILE) << ": "
+                  << strerror(errno) << std::endl;
+        return false;
+    }
+    for (int slot = 0; slot < LIVE_SLOTS; slot++)
+        release(slot);
+    segment->owner = getpid();
+    return true;
+}
+
+// Takes a free slot for a session of `rom_file`, -1 if none is left.
+int LiveSessions::acquire(const std::string& rom_file, long long start_time)
+{
+    if (!writable || rom_file.size() >= sizeof(Data::rom_file))
+        return -1;
+    for (int slot = 0; slot < LIVE_SLOTS; slot++) {
+        if (segment->slots[slot].data.in_use)
+            continue;
+        Data data = {};
+        data.in_use = 1;
+        data.start_time = start_time;
+        data.updated_ms = Timer::clock_ms(CLOCK_MONOTONIC);
+        strcpy(data.rom_file, rom_file.c_str());
+        write(slot, data);
+        return slot;
+    }
+    return -1;
+}
+
+// Publishes the time of a session not yet in DB and whether it is stopped.
+void LiveSessions::publish(int slot, long long elapsed_ms, bool suspended)
+{
+    if (!writable || slot < 0 || slot >= LIVE_SLOTS)
+        return;
+    Data data = segment->slots[slot].data; // only this process writes it
+    data.suspended = suspended;
+    data.elapsed_ms = elapsed_ms;
+    data.updated_ms = Timer::clock_ms(CLOCK_MONOTONIC);
+    write(slot, data);
+}
+
+void LiveSessions::release(int slot)
+{
+    if (!writable || slot < 0 || slot >= LIVE_SLOTS || !segment->slots[slot].data.in_use)
+        return;
+    Data data = {};
+    write(slot, data);
+}
+
+// Tells the GUI the DB changed, once the sessions were published with their new time.
+void LiveSessions::committed()
+{
+    if (writable)
+        segment->commits.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * @brief Called each frame by the GUI: whether the DB should be checked for changes.
+ *
+ * @details True at once when the daemon committed, and once a second for the other writers
+ * (flag watcher, another GUI). The segment is mapped when the daemon first created it, its
+ * sessions ignored while the daemon is not running.
+ */
+bool LiveSessions::poll()
+{
+    long long now_ms = Timer::clock_ms(CLOCK_MONOTONIC);
+    bool      due = now_ms >= next_check_ms;
+    if (due) {
+        next_check_ms = now_ms + 1000;
+        if (segment || map(false))
+            owner_alive = segment->owner > 0 && (kill(segment->owner, 0) == 0 || errno == EPERM);
+    }
+    if (segment) {
+        uint32_t commits = segment->commits.load(std::memory_order_acquire);
+        if (commits != seen_commits) {
+            seen_commits = commits;
+            due = true;
+        }
+    }
+    return due;
+}
+
+// The live session of `rom_file`, read without locking nor blocking the daemon.
+std::optional<LiveSession> LiveSessions::find(const std::string& rom_file) const
+{
+    if (!segment || !owner_alive)
+        return std::nullopt;
+    Data data;
+    for (int slot = 0; slot < LIVE_SLOTS; slot++) {
+        if (!read(slot, data) || !data.in_use)
+            continue;
+        data.rom_file[sizeof(data.rom_file) - 1] = '\0';
+        if (rom_file != data.rom_file)
+            continue;
+        long long elapsed_ms = data.elapsed_ms;
+        if (!data.suspended)
+            elapsed_ms += Timer::clock_ms(CLOCK_MONOTONIC) - data.updated_ms;
+        return LiveSession{data.start_time, elapsed_ms, data.suspended != 0};
+    }
+    return std::nullopt;
+}
@@ -0,0 +1,181 @@
+#include "Readahead.h"
+
+#include "utils.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define READAHEAD_CHUNK (4 << 20)
+
+Readahead::Readahead()
+    : cfg(Config::getInstance())
+{
+}
+
+Readahead::~Readahead()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    generation++;
+    wake.notify_one();
+    if (worker.joinable())
+        worker.join();
+}
+
+/**
+ * @brief Lists the files read when launching `file`: the rom itself, then the tracks of a .cue and
+ * the discs of a .m3u (with their own tracks).
+ */
+std::vector<std::string> Readahead::rom_files(const std::string& file)
+{
+    std::vector<std::string> files = {file};
+    std::string              extension = fs::path(file).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    fs::path      dir = fs::path(file).parent_path();
+    std::ifstream list(file);
+    std::string   line;
+
+    if (extension == ".cue") {
+        // FILE "track 01.bin" BINARY
+        while (std::getline(list, line)) {
+            size_t first = line.find('"');
+            size_t last = line.rfind('"');
+            if (line.find("FILE") != std::string::npos && first != last)
+                files.push_back((dir / line.substr(first + 1, last - first - 1)).string());
+        }
+    } else if (extension == ".m3u") {
+        while (std::getline(list, line)) {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (line.empty() || line[0] == '#')
+                continue;
+            for (const std::string& disc_file : rom_files((dir / line).string()))
+                files.push_back(disc_file);
+        }
+    }
+    return files;
+}
+
+/**
+ * @brief Share of the files of `file` already in the page cache, in percent (-1 if unreadable).
+ */
+int Readahead::cached_percent(const std::string& file)
+{
+    long   page = sysconf(_SC_PAGESIZE);
+    size_t pages = 0;
+    size_t cached = 0;
+    for (const std::string& path : rom_files(file)) {
+        int         fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (fd == -1)
+            continue;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (map != MAP_FAILED) {
+                std::vector<unsigned char> resident((st.st_size + page - 1) / page);
+                if (mincore(map, st.st_size, resident.data()) == 0) {
+                    pages += resident.size();
+                    for (unsigned char flags : resident)
+                        cached += flags & 1;
+                }
+                munmap(map, st.st_size);
+            }
+        }
+        close(fd);
+    }
+    return pages ? static_cast<int>(cached * 100 / pages) : -1;
+}
+
+/**
+ * @brief To be called on each frame with the selected rom (empty for none).
+ *
+ * @details A new selection cancels the reads of the previous one, the worker is handed the rom
+ * once it stayed selected for the dwell time.
+ */
+void Readahead::hover(const std::string& file)
+{
+    if (cfg.readahead_budget_mb <= 0)
+        return;
+    auto now = std::chrono::steady_clock::now();
+    if (file != hovered) {
+        hovered = file;
+        hover_start = now;
+        issued = false;
+        generation++;
+        return;
+    }
+    if (issued || file.empty() ||
+        now - hover_start < std::chrono::milliseconds(cfg.readahead_dwell_ms))
+        return;
+
+    issued = true;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = file;
+        pending_generation = generation;
+    }
+    if (!worker.joinable())
+        worker = std::thread(&Readahead::run, this);
+    wake.notify_one();
+}
+
+void Readahead::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this]() { return stopping || !pending.empty(); });
+        if (stopping)
+            return;
+        std::string file;
+        file.swap(pending);
+        unsigned request = pending_generation;
+        lock.unlock();
+
+        auto   start = std::chrono::steady_clock::now();
+        size_t budget = static_cast<size_t>(cfg.readahead_budget_mb) << 20;
+        size_t bytes = 0;
+        for (const std::string& path : rom_files(file)) {
+            if (bytes >= budget || generation != request)
+                break;
+            bytes += warm(path, budget - bytes, request);
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+        std::cout << "Readahead: " << fs::path(file).filename().string() << " " << (bytes >> 20)
+                  << " MB in " << elapsed.count() << " ms"
+                  << (generation != request ? " (cancelled)" : "") << std::endl;
+
+        lock.lock();
+    }
+}
+
+/**
+ * @brief Reads `path` into the page cache by chunks, up to `budget` bytes or until `request` is
+ * superseded.
+ *
+ * @return The number of bytes read ahead.
+ */
+size_t Readahead::warm(const std::string& path, size_t budget, unsigned request) const
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return 0;
+    struct stat st;
+    size_t      size = fstat(fd, &st) == 0 ? std::min<size_t>(st.st_size, budget) : 0;
+    size_t      offset = 0;
+    while (offset < size && generation == request) {
+        size_t length = std::min<size_t>(READAHEAD_CHUNK, size - offset);
+        // readahead blocks until the chunk is read, posix_fadvise only queues it
+        if (readahead(fd, offset, length) != 0)
+            posix_fadvise(fd, offset, length, POSIX_FADV_WILLNEED);
+        offset += length;
+    }
+    close(fd);
+    return offset;
+}
@@ -1,165 +1,529 @@
 #include "Rom.h"
 
+#include "LatencyTracker.h"
+#include "Readahead.h"
+#include "SuspendManager.h"
+#include "SystemProfile.h"
 #include "utils.h"
 
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <linux/input.h>
+#include <poll.h>
 #include <regex>
+#include <spawn.h>
+#include <sys/resource.h>
+
+extern char** environ;
 
 static std::regex img_pattern = std::regex(R"(\/Roms\/([^\/]+).*)"); // Matches "/Roms/<subfolder>"
 static std::regex sys_pattern =
     std::regex(R"(.*\/Roms\/([^\/]+).*)"); // Matches "/Roms/<subfolder>"
 // Matches "/Best/<subfolder>" (for alternate library root)
 static std::regex               best_pattern = std::regex(R"(\/Best\/([^\/]+).*)");
-std::vector<Rom>                Rom::list;
+RomTable                        Rom::list;
 std::unordered_set<std::string> Rom::ra_hotkey_roms;
 std::unordered_set<std::string> Rom::childs;
+std::unordered_set<std::string> Rom::stopped_cgroups;
 GUI&                            Rom::gui = GUI::getInstance();
 Config&                         Rom::cfg = Config::getInstance();
-DB&                             Rom::db = DB::getInstance();
 
-std::vector<Rom>& Rom::get()
+static std::string get_system(const std::string& file)
 {
-    return list;
+    return std::regex_replace(file, sys_pattern, R"($1)");
+}
+
+// How the launcher process is set up before exec.
+struct LaunchOptions
+{
+    std::string tag;    // ROM_ENV=<rom file>, added to the environment
+    std::string cgroup; // joined before exec if not empty
+    int         nice = 0;
+    cpu_set_t   cpus;
+};
+
+// Name of the cgroup of a game, stable across GUI restarts.
+static std::string cgroup_name(const std::string& file)
+{
+    std::ostringstream name;
+    name << "rom-" << std::hex << std::hash<std::string>{}(file);
+    return name.str();
+}
+
+// Whether `pid` runs our own binary, like a timer daemon started from a launch script.
+static bool runs_activities(pid_t pid)
+{
+    std::error_code error;
+    fs::path        self = fs::read_symlink("/proc/self/exe", error);
+    fs::path        exe = fs::read_symlink("/proc/" + std::to_string(pid) + "/exe", error);
+    return !self.empty() && exe == self;
+}
+
+// Environment given to games: ours with `tag` added.
+static std::vector<char*> get_environment(const std::string& tag)
+{
+    std::vector<char*> envp;
+    for (char** variable = environ; *variable; variable++)
+        if (strncmp(*variable, ROM_ENV "=", sizeof(ROM_ENV)) != 0)
+            envp.push_back(*variable);
+    envp.push_back(const_cast<char*>(tag.c_str()));
+    envp.push_back(nullptr);
+    return envp;
+}
+
+/**
+ * @brief Launches `launcher file` with posix_spawn (vfork semantics, no page table copy).
+ *
+ * @details The child starts a new session and only inherits the standard fds, every other one
+ * being marked close-on-exec first. posix_spawn has no attribute for niceness nor affinity, so they
+ * are set on the calling thread around the call and inherited. Joining the cgroup before exec
+ * goes through a one line shell, `0` standing for the writing process itself. The game is launched
+ * even if it could not join, freeze() then falling back on signals.
+ *
+ * @return The pid of the launcher, -1 on failure.
+ */
+static pid_t spawn_launcher(
+    const std::string& launcher, const std::string& file, const LaunchOptions& options)
+{
+    utils::set_cloexec_on_all_fds();
+    std::vector<char*> envp = get_environment(options.tag);
+
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+#ifdef POSIX_SPAWN_SETSID
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID);
+#else
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attr, 0);
+#endif
+
+    std::vector<std::string> args = {launcher, file};
+    if (!options.cgroup.empty())
+        args = {"/bin/sh", "-c",
+            "{ echo 0 > \"$0/cgroup.procs\"; } 2>/dev/null || "
+            "echo \"Could not join the cgroup $0\" >&2; exec \"$1\" \"$2\"",
+            options.cgroup, launcher, file};
+    std::vector<char*> argv;
+    for (std::string& arg : args)
+        argv.push_back(&arg[0]);
+    argv.push_back(nullptr);
+
+    // Set even when matching the defaults: the GUI may be stepped back for another game
+    int       previous_nice = getpriority(PRIO_PROCESS, 0);
+    cpu_set_t previous_cpus;
+    sched_getaffinity(0, sizeof(previous_cpus), &previous_cpus);
+    setpriority(PRIO_PROCESS, 0, options.nice);
+    sched_setaffinity(0, sizeof(options.cpus), &options.cpus);
+
+    pid_t pid;
+    int   error = posix_spawn(&pid, argv[0], nullptr, &attr, argv.data(), envp.data());
+
+    setpriority(PRIO_PROCESS, 0, previous_nice);
+    sched_setaffinity(0, sizeof(previous_cpus), &previous_cpus);
+    posix_spawnattr_destroy(&attr);
+
+    if (error) {
+        std::cerr << "posix_spawn " << argv[0] << " failed: " << strerror(error) << std::endl;
+        return -1;
+    }
+    return pid;
+}
+
+/**
+ * @brief Launches `launcher file` with fork and execl, returning once exec succeeded.
+ *
+ * @details A close-on-exec pipe tells the parent when the child reached exec, so both launch paths
+ * can be timed the same way. Other threads may run (page-out, readahead), so the child only makes
+ * async-signal-safe calls: everything it needs is built before fork.
+ */
+static pid_t fork_launcher(
+    const std::string& launcher, const std::string& file, const LaunchOptions& options)
+{
+    int exec_pipe[2];
+    if (pipe2(exec_pipe, O_CLOEXEC) == -1)
+        return -1;
+    std::vector<char*> envp = get_environment(options.tag);
+    std::string        procs = options.cgroup.empty() ? "" : options.cgroup + "/cgroup.procs";
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        setsid();
+        // Join the cgroup before exec so every process of the game is in it
+        int procs_fd = procs.empty() ? -1 : open(procs.c_str(), O_WRONLY | O_CLOEXEC);
+        if (procs_fd != -1) {
+            (void) !write(procs_fd, "0", 1);
+            close(procs_fd);
+        }
+        setpriority(PRIO_PROCESS, 0, options.nice);
+        sched_setaffinity(0, sizeof(options.cpus), &options.cpus);
+
+        execle(launcher.c_str(), launcher.c_str(), file.c_str(), (char*) NULL, envp.data());
+        int error = errno;
+        (void) !write(exec_pipe[1], &error, sizeof(error));
+        _exit(1);
+    }
+    close(exec_pipe[1]);
+    int error = 0;
+    if (pid > 0 && read(exec_pipe[0], &error, sizeof(error)) > 0) {
+        std::cerr << "execl " << launcher << " failed: " << strerror(error) << std::endl;
+        waitpid(pid, nullptr, 0);
+        pid = -1;
+    }
+    close(exec_pipe[0]);
+    return pid;
 }
 
-Rom* Rom::get(const std::string& rom_file)
+RomTable& Rom::get()
 {
-    auto it = list.begin();
-    do {
-        if (it->file == rom_file || fs::path(it->file).filename() == fs::path(rom_file)) {
-            std::cout << "ROM " << it->name << "found in database." << std::endl;
+    return list;
+}
 
-            return &(*it);
+std::optional<Rom> Rom::get(const std::string& rom_file)
+{
+    for (RomTable::Row row = 0; row < list.rows(); row++) {
+        if (!list.alive(row))
+            continue;
+        std::string file = list.str(list.file[row]);
+        if (file == rom_file || fs::path(file).filename() == fs::path(rom_file)) {
+            std::cout << "ROM " << list.str(list.name[row]) << "found in database." << std::endl;
+            return Rom(list.handle(row));
         }
-    } while (++it != list.end());
-    return nullptr;
+    }
+    return std::nullopt;
 }
 
+/**
+ * @brief Synchronizes the roms table with the database.
+ *
+ * @details Rows already loaded are updated in place so their runtime state (pid, resolved
+ * assets) is kept, new DB entries are appended and rows no longer in DB are dropped unless their
+ * game is running.
+ */
 void Rom::refresh()
 {
-    std::vector<Rom> previous_roms = list;
-    list.clear();
-    std::vector<DB_row> table = db.load();
-    for (DB_row row : table) {
-        std::vector<Rom>::iterator previous_rom = std::find_if(
-            previous_roms.begin(), previous_roms.end(), [&](Rom& r) { return r.file == row.file; });
-        if (previous_rom != previous_roms.end()) {
-            previous_rom->update(row);
-            list.push_back(*previous_rom);
+    std::vector<DB_row> table = DB::getInstance().load();
+
+    std::unordered_map<std::string, RomTable::Row> rows;
+    for (RomTable::Row row = 0; row < list.rows(); row++) {
+        if (list.alive(row))
+            rows[list.str(list.file[row])] = row;
+    }
+
+    std::vector<bool> seen(list.rows(), false);
+    for (const DB_row& db_row : table) {
+        auto it = rows.find(db_row.file);
+        if (it != rows.end()) {
+            list.update(it->second, db_row);
+            seen[it->second] = true;
         } else {
-            Rom rom(row);
-            list.push_back(rom);
+            list.insert(db_row, get_system(db_row.file));
         }
     }
+    // Only dropped from memory, running or suspended games being kept
+    for (RomTable::Row row = 0; row < seen.size(); row++) {
+        if (!seen[row] && list.alive(row) && list.pid[row] == -1)
+            list.remove(list.handle(row));
+    }
 
-    std::cout << "Loaded " << list.size() << " roms." << std::endl;
-    for (const auto& rom : list)
-        std::cout << "  - " << rom.name << " (" << rom.file << ")" << std::endl;
+    size_t bytes = list.memory_usage();
+    std::cout << "Loaded " << list.size() << " roms in " << bytes << " bytes ("
+              << (list.empty() ? 0 : bytes / list.size()) << " bytes/rom)." << std::endl;
 }
 
-DB_row Rom::get_DB_row()
+Rom::Rom(RomHandle handle)
+    : handle(handle)
 {
-    return {file, name, count, time, lastsessiontime, last, completed, favorite};
 }
 
-void Rom::update(DB_row row)
+// False once the rom was removed from the table.
+bool Rom::valid() const
 {
-    count = row.count;
-    time = row.time;
-    lastsessiontime = row.lastsessiontime;
-    last = row.last;
-    total_time = utils::stringifyTime(time);
-    average_time = utils::stringifyTime(count ? time / count : 0);
+    return list.valid(handle);
 }
 
-Rom* Rom::save()
+std::string Rom::file() const
 {
-    db.save(get_DB_row());
-    auto it = std::find_if(list.begin(), list.end(), [&](const Rom& r) { return r.file == file; });
-    if (it != list.end())
-        return &(*it);
-    list.push_back(*this);
-    return &list.back();
+    return list.str(list.file[handle.row]);
 }
 
-void Rom::remove()
+std::string Rom::name() const
+{
+    return list.str(list.name[handle.row]);
+}
+
+int Rom::count() const
+{
+    return list.count[handle.row];
+}
+
+int Rom::time() const
+{
+    return list.time[handle.row];
+}
+
+int Rom::lastsessiontime() const
+{
+    return list.lastsessiontime[handle.row];
+}
+
+std::string Rom::last() const
+{
+    return utils::formatDateTime(list.last[handle.row]);
+}
+
+int Rom::completed() const
+{
+    return list.completed[handle.row];
+}
+
+int Rom::favorite() const
+{
+    return list.favorite[handle.row];
+}
+
+pid_t Rom::pid() const
+{
+    return list.pid[handle.row];
+}
+
+const std::string& Rom::system() const
+{
+    return list.systems.get(list.system[handle.row]);
+}
+
+std::string Rom::total_time() const
 {
-    db.remove(file);
-    list.erase(
-        std::remove_if(list.begin(), list.end(), [this](const Rom& r) { return file == r.file; }),
-        list.end());
+    return utils::stringifyTime(list.time[handle.row]);
 }
 
-void Rom::fill_opts()
+std::string Rom::average_time() const
 {
-    std::string imgBase;
-    if (std::regex_search(file, best_pattern))
-        imgBase = std::regex_replace(file, best_pattern, R"(/Best/$1/Imgs)");
-    else
-        imgBase = std::regex_replace(file, img_pattern, R"(/Imgs/$1)");
+    int count = list.count[handle.row];
+    return utils::stringifyTime(count ? list.time[handle.row] / count : 0);
+}
 
-    image = imgBase + "/" + name + ".png";
-    if (!fs::exists(image))
-        image = "";
+void Rom::set_completed(int completed)
+{
+    list.completed[handle.row] = completed;
+}
 
-    video = std::regex_replace(file, img_pattern, R"(/Videos/$1)") + "/" + name + ".mp4";
-    if (!fs::exists(video))
-        video = "";
+void Rom::set_favorite(int favorite)
+{
+    list.favorite[handle.row] = favorite;
+}
 
-    manual = std::regex_replace(file, img_pattern, R"(/Manuals/$1)") + "/" + name + ".pdf";
-    if (!fs::exists(manual))
-        manual = "";
+// Persist completed/favorite flags. Zero time tells DB to keep the recorded sessions.
+void Rom::save()
+{
+    DB::getInstance().save(
+        {file(), name(), 0, 0, 0, "-", list.completed[handle.row], list.favorite[handle.row]});
+}
 
-    system = std::regex_replace(file, sys_pattern, R"($1)");
-    total_time = utils::stringifyTime(time);
-    average_time = utils::stringifyTime(count ? time / count : 0);
-    launcher = utils::get_launcher(system, name);
+void Rom::remove()
+{
+    if (list.pid[handle.row] != -1)
+        stop();
+    DB::getInstance().remove(file());
+    list.remove(handle);
 }
 
-Rom::Rom(DB_row row)
-    : file(row.file)
-    , name(row.name)
-    , count(row.count)
-    , time(row.time)
-    , lastsessiontime(row.lastsessiontime)
-    , last(row.last)
-    , completed(row.completed)
-    , favorite(row.favorite)
+// Record a finished session of `time` seconds, from the timer process.
+void Rom::save_session(const std::string& rom_file, int time)
 {
-    fill_opts();
+    fs::path filepath(rom_file);
+    DB::getInstance().save({utils::shorten_file_path(rom_file), filepath.stem(), time ? 1 : 0,
+        time, time, time ? utils::getCurrentDateTime() : "-", 0, 0});
 }
 
-Rom::Rom(const std::string& _file, int _time)
-    : time(_time)
-    , lastsessiontime(_time)
+// Adds a session of `rom_file` and the resources it used to the history.
+void Rom::save_profile(const std::string& rom_file, int time, const SessionProfile& profile)
 {
-    fs::path filepath(_file);
+    std::string file = utils::shorten_file_path(rom_file);
+    DB::getInstance().save_profile(file, get_system(file), time, profile);
+}
 
-    file = utils::shorten_file_path(_file);
-    name = filepath.stem();
-    if (time) {
-        count = 1;
-        last = utils::getCurrentDateTime();
+// Returns the rom of `rom_file`, adding it to DB and table if needed.
+Rom Rom::add(const std::string& rom_file)
+{
+    std::string        file = utils::shorten_file_path(rom_file);
+    std::optional<Rom> rom = get(file);
+    if (rom)
+        return *rom;
+
+    DB_row db_row = {file, fs::path(rom_file).stem(), 0, 0, 0, "-", 0, 0};
+    DB::getInstance().save(db_row);
+    return Rom(list.insert(db_row, get_system(file)));
+}
+
+/**
+ * @brief Resolves the requested assets paths if not already done.
+ *
+ * @details Image, video, manual and launcher lookups hit the SD card (stat and config files
+ * reads), while only the roms displayed on screen ever need them. They are so resolved on first
+ * access and memoized in the table so each lookup happens at most once per rom.
+ *
+ * @param assets A combination of ASSET_* flags.
+ * @return The rom's assets entry.
+ */
+RomAssets& Rom::resolve(int assets)
+{
+    RomAssets& entry = list.assets[handle.row];
+    assets &= ~entry.resolved;
+    if (!assets)
+        return entry;
+
+    std::string file = this->file();
+    std::string name = this->name();
+
+    if (assets & ASSET_IMAGE) {
+        std::string imgBase;
+        if (std::regex_search(file, best_pattern))
+            imgBase = std::regex_replace(file, best_pattern, R"(/Best/$1/Imgs)");
+        else
+            imgBase = std::regex_replace(file, img_pattern, R"(/Imgs/$1)");
+
+        entry.image = imgBase + "/" + name + ".png";
+        if (!fs::exists(entry.image))
+            entry.image = "";
     }
-    fill_opts();
+
+    if (assets & ASSET_VIDEO) {
+        entry.video = std::regex_replace(file, img_pattern, R"(/Videos/$1)") + "/" + name + ".mp4";
+        if (!fs::exists(entry.video))
+            entry.video = "";
+    }
+
+    if (assets & ASSET_MANUAL) {
+        entry.manual =
+            std::regex_replace(file, img_pattern, R"(/Manuals/$1)") + "/" + name + ".pdf";
+        if (!fs::exists(entry.manual))
+            entry.manual = "";
+    }
+
+    if (assets & ASSET_LAUNCHER)
+        list.launcher[handle.row] = list.launchers.intern(utils::get_launcher(system(), name));
+
+    entry.resolved |= assets;
+    return entry;
 }
 
-Rom::Rom(const std::string& _file)
-    : Rom(_file, 0)
+const std::string& Rom::get_image()
 {
+    return resolve(ASSET_IMAGE).image;
 }
 
-Rom::~Rom()
+const std::string& Rom::get_video()
 {
-    if (pid != -1) {
-        utils::resume_process_group(pid);
-        utils::kill_process_group(pid);
+    return resolve(ASSET_VIDEO).video;
+}
+
+const std::string& Rom::get_manual()
+{
+    return resolve(ASSET_MANUAL).manual;
+}
+
+const std::string& Rom::get_launcher()
+{
+    resolve(ASSET_LAUNCHER);
+    return list.launchers.get(list.launcher[handle.row]);
+}
+
+void Rom::set_launcher(const std::string& new_launcher)
+{
+    utils::set_launcher(system(), name(), new_launcher);
+    list.launcher[handle.row] = list.launchers.intern(new_launcher);
+    list.assets[handle.row].resolved |= ASSET_LAUNCHER;
+}
+
+// Resolve everything ahead of time for roms about to be displayed.
+void Rom::prefetch()
+{
+    resolve(ASSET_ALL);
+}
+
+/**
+ * @brief Re-attaches the games launched by a previous GUI instance that are still alive.
+ *
+ * @details Games are found by the ROM_ENV variable of their environment, and by the cgroup of
+ * their rom when it has one. Their process group and cgroup are attached back to their rom, they
+ * are frozen if not already and handled like any suspended game, so `auto_resume` resumes them
+ * instead of launching them again.
+ *
+ * @return The number of games adopted.
+ */
+int Rom::adopt_orphans()
+{
+    Uint32 start = SDL_GetTicks();
+    int    adopted = 0;
+    for (const auto& group : utils::find_process_groups_by_env(ROM_ENV)) {
+        pid_t              pgid = group.first;
+        const std::string& rom_file = group.second;
+        if (pgid == getpgrp())
+            continue;
+        // Other groups inherit the tag too, like the timer daemon started from a launch script:
+        // only the group in the cgroup of the rom, when it has one, is the game
+        std::string cgroup = "/activities/" + cgroup_name(rom_file);
+        bool        in_cgroup = utils::get_process_cgroup(pgid) == cgroup;
+        if ((!in_cgroup && fs::exists(cfg.cgroup_root + cgroup)) || runs_activities(pgid))
+            continue;
+        RomHandle found = list.find(rom_file);
+        Rom       rom = list.valid(found) ? Rom(found) : add(rom_file);
+        if (!rom.valid() || rom.pid() != -1)
+            continue;
+
+        list.pid[rom.handle.row] = pgid;
+        if (in_cgroup)
+            list.cgroup[rom.handle.row] = cfg.cgroup_root + cgroup;
+        rom.freeze();
+        childs.insert(rom_file);
+        SuspendManager::getInstance().suspended(rom);
+        std::cout << "ActivitiesApp: Adopted " << rom.name() << " (PGID: " << pgid << ")"
+                  << std::endl;
+        adopted++;
+    }
+    if (adopted) {
+        export_childs_list();
+        std::cout << "ActivitiesApp: Adopted " << adopted << " games in "
+                  << SDL_GetTicks() - start << " ms" << std::endl;
+    }
+    return adopted;
+}
+
+// Resume then terminate every suspended game, on GUI exit.
+void Rom::release_all()
+{
+    SystemProfile::getInstance().restore();
+    bool any = false;
+    for (RomTable::Row row = 0; row < list.rows(); row++) {
+        if (list.alive(row) && list.pid[row] != -1) {
+            Rom(list.handle(row)).terminate();
+            list.pid[row] = -1;
+            any = true;
+        }
+    }
+    if (any)
         gui.message_popup(15, {{"Please wait...", 32, cfg.title_color},
                                   {"We save suspended games.", 18, cfg.title_color}});
+    // Give the games some time to save and exit, not to leave their cgroups behind
+    for (int tries = 0; !stopped_cgroups.empty() && tries < 50; tries++) {
+        SDL_Delay(100);
+        remove_cgroups();
     }
 }
 
+/**
+ * @brief Removes the cgroups of the games stopped or exited, once their last process is gone.
+ *
+ * @details A terminated game may take a while to save and exit, and its cgroup can only be removed
+ * once empty, so they are retried from the GUI loop until then.
+ */
+void Rom::remove_cgroups()
+{
+    for (auto it = stopped_cgroups.begin(); it != stopped_cgroups.end();)
+        it = utils::cgroup_remove(*it) ? stopped_cgroups.erase(it) : std::next(it);
+}
+
 /**
  * @brief Starts or resumes the game process.
  *
@@ -175,10 +539,15 @@ Rom::~Rom()
  */
 void Rom::start()
 {
+    std::string file = this->file();
+    std::string name = this->name();
+    pid_t&      pid = list.pid[handle.row];
     std::cout << "ActivitiesApp: Launching " << name << std::endl;
+    LatencyTracker::getInstance().begin(*this, pid != -1);
 
     if (pid != -1) {
-        utils::resume_process_group(pid);
+        thaw();
+        SuspendManager::getInstance().resumed(*this);
         std::cout << "Resuming process group: " << name << std::endl;
         // Restore ra_hotkey only if it existed when we suspended this game
         auto it = ra_hotkey_roms.find(file);
@@ -194,19 +563,37 @@ void Rom::start()
             return;
         }
 
-        pid = fork();
-        if (pid == 0) {
-            setsid();
-            std::string launcher = "/mnt/SDCARD/Emus/" + system + "/default.sh";
-
-            execl(launcher.c_str(), launcher.c_str(), file.c_str(), (char*) NULL);
+        LaunchOptions options;
+        options.tag = ROM_ENV "=" + file;
+        if (cfg.use_cgroups)
+            options.cgroup = utils::cgroup_create(cfg.cgroup_root, cgroup_name(file));
+        // Still there if the previous run of the game did not exit yet
+        stopped_cgroups.erase(options.cgroup);
+        options.nice = SystemProfile::getInstance().game_nice(system());
+        options.cpus = SystemProfile::getInstance().game_cpus(system());
+
+        std::string launcher = "/mnt/SDCARD/Emus/" + system() + "/default.sh";
+        int         cached = Readahead::cached_percent(file);
+        auto        launch_start = std::chrono::steady_clock::now();
+        pid = cfg.use_posix_spawn ? spawn_launcher(launcher, file, options)
+                                  : fork_launcher(launcher, file, options);
+        auto time_to_exec = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - launch_start);
+        if (pid == -1) {
             std::cerr << "Failed to launch " << name << std::endl;
-            exit(1);
-        } else {
-            childs.insert(file);
-            export_childs_list();
+            utils::cgroup_remove(options.cgroup);
+            return;
         }
+        std::cout << "ActivitiesApp: " << name << " exec in " << time_to_exec.count() << " us ("
+                  << (cfg.use_posix_spawn ? "posix_spawn" : "fork") << "), cache "
+                  << (cached >= 50 ? "warm" : "cold") << " (" << cached << "% cached)" << std::endl;
+        if (!options.cgroup.empty())
+            list.cgroup[handle.row] = options.cgroup;
+        childs.insert(file);
+        export_childs_list();
     }
+    SystemProfile::getInstance().apply(system(), pid);
+    gui.enter_background();
 }
 
 /**
@@ -221,10 +608,10 @@ void Rom::start()
  */
 void Rom::stop()
 {
-    utils::resume_process_group(pid);
-    utils::kill_process_group(pid);
-    childs.erase(file);
-    pid = -1;
+    SuspendManager::getInstance().forget(*this);
+    terminate();
+    childs.erase(file());
+    list.pid[handle.row] = -1;
     export_childs_list();
 }
 
@@ -243,124 +630,289 @@ void Rom::stop()
 void Rom::suspend()
 {
     if (utils::ra_hotkey_exists())
-        ra_hotkey_roms.insert(file);
-    utils::suspend_process_group(pid);
+        ra_hotkey_roms.insert(file());
+    freeze();
     utils::remove_ra_hotkey();
+    SystemProfile::getInstance().restore();
+    SuspendManager::getInstance().suspended(*this);
+}
+
+/**
+ * @brief Stops every process of the game: freezes its cgroup if the game is in it, else sends
+ * SIGSTOP to its process group.
+ */
+void Rom::freeze()
+{
+    auto it = list.cgroup.find(handle.row);
+    if (it == list.cgroup.end() || !utils::cgroup_populated(it->second) ||
+        !utils::cgroup_write(it->second, "cgroup.freeze", "1"))
+        utils::suspend_process_group(list.pid[handle.row]);
+}
+
+// Resumes the game, undoing freeze().
+void Rom::thaw()
+{
+    auto it = list.cgroup.find(handle.row);
+    if (it == list.cgroup.end() || !utils::cgroup_populated(it->second) ||
+        !utils::cgroup_write(it->second, "cgroup.freeze", "0"))
+        utils::resume_process_group(list.pid[handle.row]);
+}
+
+// Asks every process of the game to terminate, letting emulators save on exit.
+void Rom::terminate()
+{
+    thaw();
+    utils::kill_process_group(list.pid[handle.row]);
+    auto it = list.cgroup.find(handle.row);
+    if (it != list.cgroup.end())
+        utils::cgroup_signal(it->second, SIGTERM);
+    release_cgroup();
+}
+
+// Detaches the cgroup from the game, to be removed by remove_cgroups() once empty.
+void Rom::release_cgroup()
+{
+    auto it = list.cgroup.find(handle.row);
+    if (it == list.cgroup.end())
+        return;
+    stopped_cgroups.insert(it->second);
+    list.cgroup.erase(it);
+    remove_cgroups();
+}
+
+// Memory used by the game cgroup in bytes, -1 without cgroup.
+long Rom::memory_current() const
+{
+    auto it = list.cgroup.find(handle.row);
+    if (it == list.cgroup.end())
+        return -1;
+    std::string value = utils::cgroup_read(it->second, "memory.current");
+    return value.empty() ? -1 : std::stol(value);
+}
+
+// CPU time used by the game cgroup in microseconds, -1 without cgroup.
+long Rom::cpu_usage_usec() const
+{
+    auto it = list.cgroup.find(handle.row);
+    if (it == list.cgroup.end())
+        return -1;
+    std::istringstream stat(utils::cgroup_read(it->second, "cpu.stat"));
+    std::string        key;
+    long               value;
+    while (stat >> key >> value)
+        if (key == "usage_usec")
+            return value;
+    return -1;
+}
+
+/**
+ * @brief Suspends the game and lets the user pick where to go in the GUI.
+ *
+ * @details Freezes the game, takes a screenshot to use as a background, and presents a
+ * `string_selector` menu. The user can resume the game with B or switch to another part of the
+ * application ("Running", "Favorites" or "Any").
+ *
+ * @return -1 if the game was resumed, otherwise the `wait()` code of the list chosen.
+ */
+int Rom::switch_menu()
+{
+    std::string file = this->file();
+    freeze();
+    gui.leave_background();
+    // Drop the inputs sent to the game
+    SDL_PumpEvents();
+    SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+    gui.save_background_texture(gui.take_screenshot());
+
+    std::vector<std::string> choices;
+    choices.push_back("Running");
+    choices.push_back("Favorites");
+    choices.push_back("Any");
+    std::string choice = gui.string_selector("Switch to: ", choices, gui.Width / 3, true);
+    if (choice == "") {
+        thaw();
+        gui.delete_background_texture();
+        gui.enter_background();
+        return -1;
+    }
+    if (utils::ra_hotkey_exists()) {
+        ra_hotkey_roms.insert(file);
+        utils::remove_ra_hotkey();
+    }
+    std::cout << "ActivitiesApp: Game " << file << " suspended" << std::endl;
+    gui.delete_background_texture();
+    SuspendManager::getInstance().suspended(*this);
+    if (choice == "Running")
+        return 1;
+    if (choice == "Favorites")
+        return 2;
+    return 3;
 }
 
 /**
  * @brief Waits for the child process to exit, handling suspension and context switching.
  *
  * @details This function puts the main application into a waiting state while the child
- * game process is running. It continuously polls for the child process's status to
- * detect its termination. It also processes `SDL` events to detect a specific button
- * combination (joystick buttons 6(Select) and 7(Start)) that triggers a context switch.
- * Upon detecting the button combo, it suspends the game process, takes a screenshot
- * to use as a background, and presents a `string_selector` menu to the user.
- * The user can choose to resume the game with B key or switch to another part of the application
- * (e.g., "Running," "Favorites," or "Any"). Depending on the user's choice,
- * the function either resumes the game or returns a specific value to signal a context switch.
+ * game process is running. It sleeps in a single `poll()` over a pidfd of the game, readable
+ * once it exits, and the evdev node of the joystick, so the GUI does not wake up until the game
+ * exits or a button is pressed. Joystick buttons 6 (Select) and 7 (Start) pressed together open
+ * the `switch_menu()`.
+ *
+ * Without pidfd (Linux < 5.3) or joystick evdev node, or once the node went away, it falls back
+ * to checking the process and the `SDL` events every 100 ms. So does it while the resume of a
+ * paged out game is measured, and after a launch until the game started, for SystemProfile to
+ * schedule its helpers.
  *
- * @return A `std::pair<pid_t, int>`. The `pid_t` is the PID of the process that was
- * being waited on. The integer return code indicates the outcome:
+ * @return The integer return code indicates the outcome:
  * - `0`: The game process exited normally or an error occurred.
  * - `1`: The user chose to switch to the "Running" games list.
  * - `2`: The user chose to switch to the "Favorites" games list.
- * - `3`: The user chose to switch to the "Any" games list.
+ * - `3`: The user chose to switch to the "Any" games list, or the game was killed by a signal.
  *
  * @note This function is critical for allowing a seamless transition between a running game
  * and the main GUI while preserving the game's state.
  */
 int Rom::wait()
 {
-    int combo = 0;
+    std::string file = this->file();
+    pid_t&      pid = list.pid[handle.row];
+    int         combo = 0;
     if (pid == -1) {
         std::cerr << "ActivitiesApp: Could not find child process for " << file << std::endl;
         return 0;
     }
     std::cout << "Waiting for " << file << " (PID: " << pid << ")" << std::endl;
 
-    // Pause the GUI interface while the game is running
-    int status = 0;
-
-    while (true) {
-
-        // Check if the process still exists
-        if (kill(pid, 0) != 0 && errno == ESRCH) {
-            std::cout << "ActivitiesApp: Game " << file << " exited (process no longer exists)"
+    int pidfd = utils::pidfd_open(pid);
+    int joystick_fd = utils::open_gamepad_evdev(gui.joystick_name());
+    int select_code = -1;
+    int start_code = -1;
+    if (joystick_fd != -1) {
+        std::vector<int> buttons = utils::get_evdev_buttons(joystick_fd);
+        if (buttons.size() > 7) {
+            select_code = buttons[6];
+            start_code = buttons[7];
+        } else {
+            close(joystick_fd);
+            joystick_fd = -1;
+        }
+    }
+    // poll() ignores negative fds
+    struct pollfd fds[2] = {{pidfd, POLLIN, 0}, {joystick_fd, POLLIN, 0}};
+
+    int  status = 0;
+    int  ret = -1;
+    bool exited = false;
+    while (ret == -1) {
+        bool sampling = SuspendManager::getInstance().sample_resume(*this);
+        bool measuring = LatencyTracker::getInstance().sample(*this);
+        bool scheduling = SystemProfile::getInstance().schedule_pending();
+        bool event_driven = pidfd != -1 && joystick_fd != -1 && !sampling && !scheduling;
+        int  timeout = measuring ? 10 : event_driven ? -1 : 100;
+        if (poll(fds, 2, timeout) == -1 && errno != EINTR) {
+            std::cerr << "ActivitiesApp: poll failed: " << strerror(errno) << std::endl;
+            SDL_Delay(100);
+        }
+        // The controller was unplugged or went to sleep: its node would keep waking poll()
+        if (joystick_fd != -1 && (fds[1].revents & (POLLERR | POLLHUP | POLLNVAL))) {
+            std::cerr << "ActivitiesApp: Lost the joystick evdev node, polling SDL events"
                       << std::endl;
-            break;
+            close(joystick_fd);
+            joystick_fd = -1;
+            fds[1].fd = -1;
         }
 
-        // Check if the process has terminated
-        pid_t result = waitpid(pid, &status, WNOHANG);
-        if (result == pid) {
-            // If the game was stoped by a signal, that mostly because of
-            // cmd_to_launch_killer.sh
-            // so we not remove it from child to keep it in autostarts
-            if (WIFSIGNALED(status)) {
-                return 3;
-                std::cout << "ActivitiesApp: Game " << file << " exited with status " << status
-                          << std::endl;
+        if (pidfd == -1 || fds[0].revents) {
+            // Check if the process still exists
+            if (kill(pid, 0) != 0 && errno == ESRCH) {
+                std::cout << "ActivitiesApp: Game " << file
+                          << " exited (process no longer exists)" << std::endl;
+                exited = true;
+                break;
             }
-            break;
-        }
-        // Pause the GUI interface while the game is running
-        SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
-
-        // Process SDL events
-        SDL_Event e;
-        while (SDL_PollEvent(&e)) {
-            if (e.type == SDL_QUIT)
-                return 0;
-
-            if (e.type == SDL_JOYBUTTONDOWN) {
-                switch (e.jbutton.button) {
-                case 6: combo |= 1; break;
-                case 7: combo |= 2; break;
-                default: break;
-                }
-            } else if (e.type == SDL_JOYBUTTONUP) {
-                switch (e.jbutton.button) {
-                case 6: combo &= ~1; break;
-                case 7: combo &= ~2; break;
-                default: break;
+
+            // Check if the process has terminated. Adopted games are not our children, their
+            // pidfd being readable is enough.
+            pid_t result = waitpid(pid, &status, WNOHANG);
+            if (result == -1 && errno == ECHILD && pidfd != -1) {
+                exited = true;
+                break;
+            }
+            if (result == pid) {
+                // If the game was stoped by a signal, that mostly because of
+                // cmd_to_launch_killer.sh
+                // so we not remove it from child to keep it in autostarts
+                if (WIFSIGNALED(status)) {
+                    std::cout << "ActivitiesApp: Game " << file << " exited with status "
+                              << status << std::endl;
+                    ret = 3;
+                    break;
                 }
+                exited = true;
+                break;
+            }
+        }
+
+        if (joystick_fd != -1) {
+            struct input_event event;
+            while (read(joystick_fd, &event, sizeof(event)) == sizeof(event)) {
+                if (event.type != EV_KEY)
+                    continue;
+                int bit = event.code == select_code ? 1 : event.code == start_code ? 2 : 0;
+                if (event.value)
+                    combo |= bit;
+                else
+                    combo &= ~bit;
             }
-            if (combo == 3) {
-                combo = 0;
-                utils::suspend_process_group(pid);
-                gui.save_background_texture(gui.take_screenshot());
-
-                std::vector<std::string> choices;
-                choices.push_back("Running");
-                choices.push_back("Favorites");
-                choices.push_back("Any");
-                std::string choice =
-                    gui.string_selector("Switch to: ", choices, gui.Width / 3, true);
-                if (choice == "") {
-                    utils::resume_process_group(pid);
-                    gui.delete_background_texture();
-                } else {
-                    if (utils::ra_hotkey_exists()) {
-                        ra_hotkey_roms.insert(file);
-                        utils::remove_ra_hotkey();
+        } else {
+            // Process SDL events
+            SDL_Event e;
+            while (SDL_PollEvent(&e)) {
+                if (e.type == SDL_QUIT) {
+                    ret = 0;
+                    break;
+                }
+                if (e.type == SDL_JOYBUTTONDOWN) {
+                    switch (e.jbutton.button) {
+                    case 6: combo |= 1; break;
+                    case 7: combo |= 2; break;
+                    default: break;
+                    }
+                } else if (e.type == SDL_JOYBUTTONUP) {
+                    switch (e.jbutton.button) {
+                    case 6: combo &= ~1; break;
+                    case 7: combo &= ~2; break;
+                    default: break;
                     }
-                    std::cout << "ActivitiesApp: Game " << file << " suspended" << std::endl;
-                    gui.delete_background_texture();
-                    if (choice == "Running")
-                        return 1;
-                    if (choice == "Favorites")
-                        return 2;
-                    if (choice == "Any")
-                        return 3;
                 }
+                if (combo == 3)
+                    break;
             }
         }
 
-        SDL_Delay(100); // Increased delay to reduce CPU load
+        if (combo == 3) {
+            combo = 0;
+            ret = switch_menu();
+            // Drop the inputs read by the menu
+            struct input_event event;
+            while (joystick_fd != -1 && read(joystick_fd, &event, sizeof(event)) > 0) {
+            }
+        }
     }
+    if (pidfd != -1)
+        close(pidfd);
+    if (joystick_fd != -1)
+        close(joystick_fd);
+    // Drop the inputs sent to the game
+    SDL_PumpEvents();
+    SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+    SystemProfile::getInstance().restore();
+    if (!exited)
+        return ret;
+
     pid = -1;
+    SuspendManager::getInstance().forget(*this);
+    release_cgroup();
     utils::remove_ra_hotkey();
     ra_hotkey_roms.erase(file);
     childs.erase(file);
@@ -384,10 +936,10 @@ int Rom::wait()
 void Rom::export_childs_list()
 {
     if (childs.empty()) {
-        std::remove("/mnt/SDCARD/Apps/Activities/data/autostarts.txt");
+        std::remove(utils::instance_path(AUTOSTARTS_FILE).c_str());
         return;
     }
-    std::ofstream file("/mnt/SDCARD/Apps/Activities/data/autostarts.txt", std::ios::trunc);
+    std::ofstream file(utils::instance_path(AUTOSTARTS_FILE), std::ios::trunc);
 
     if (!file.fail()) {
         for (const std::string& romFile : childs)
@@ -0,0 +1,161 @@
+#include "RomTable.h"
+
+#include "utils.h"
+
+#include <cstring>
+
+uint16_t StringPool::intern(const std::string& str)
+{
+    auto it = ids.find(str);
+    if (it != ids.end())
+        return it->second;
+    uint16_t id = static_cast<uint16_t>(strings.size());
+    strings.push_back(str);
+    ids[str] = id;
+    return id;
+}
+
+uint16_t StringPool::find(const std::string& str) const
+{
+    auto it = ids.find(str);
+    return it == ids.end() ? npos : it->second;
+}
+
+size_t StringPool::memory_usage() const
+{
+    size_t bytes = strings.capacity() * sizeof(std::string);
+    for (const std::string& str : strings)
+        bytes += 2 * str.capacity(); // strings content plus their copy as map key
+    bytes += ids.size() * (sizeof(std::pair<std::string, uint16_t>) + 2 * sizeof(void*));
+    bytes += ids.bucket_count() * sizeof(void*);
+    return bytes;
+}
+
+uint32_t RomTable::store(const std::string& str)
+{
+    uint32_t offset = static_cast<uint32_t>(arena.size());
+    arena.insert(arena.end(), str.begin(), str.end());
+    arena.push_back('\0');
+    return offset;
+}
+
+/**
+ * @brief Rewrites the arena without the strings of removed rows.
+ */
+void RomTable::compact()
+{
+    std::vector<char> previous;
+    previous.swap(arena);
+    arena.reserve(previous.size() - wasted);
+    for (Row row = 0; row < rows(); row++) {
+        if (!alive(row))
+            continue;
+        file[row] = store(previous.data() + file[row]);
+        name[row] = store(previous.data() + name[row]);
+    }
+    wasted = 0;
+}
+
+bool RomTable::valid(RomHandle handle) const
+{
+    return handle.row < rows() && generation[handle.row] == handle.generation;
+}
+
+/**
+ * @brief Adds a row, reusing the slot of a removed one if any.
+ *
+ * @return The handle of the new row.
+ */
+RomHandle RomTable::insert(const DB_row& db_row, const std::string& system_name)
+{
+    Row row;
+    if (free_rows.empty()) {
+        row = static_cast<Row>(rows());
+        generation.push_back(0);
+        file.push_back(0);
+        name.push_back(0);
+        count.push_back(0);
+        time.push_back(0);
+        lastsessiontime.push_back(0);
+        last.push_back(0);
+        completed.push_back(0);
+        favorite.push_back(0);
+        pid.push_back(-1);
+        system.push_back(0);
+        launcher.push_back(StringPool::npos);
+    } else {
+        row = free_rows.back();
+        free_rows.pop_back();
+    }
+
+    generation[row]++;
+    file[row] = store(db_row.file);
+    name[row] = store(db_row.name);
+    update(row, db_row);
+    pid[row] = -1;
+    system[row] = systems.intern(system_name);
+    launcher[row] = StringPool::npos;
+    return handle(row);
+}
+
+// Refresh the columns DB owns. File, name and runtime state are kept.
+void RomTable::update(Row row, const DB_row& db_row)
+{
+    count[row] = db_row.count;
+    time[row] = db_row.time;
+    lastsessiontime[row] = db_row.lastsessiontime;
+    last[row] = utils::parseDateTime(db_row.last);
+    completed[row] = db_row.completed;
+    favorite[row] = db_row.favorite;
+}
+
+/**
+ * @brief Frees the row of `handle`. Other rows and their handles are left untouched.
+ */
+void RomTable::remove(RomHandle handle)
+{
+    if (!valid(handle))
+        return;
+    Row row = handle.row;
+
+    wasted += std::strlen(str(file[row])) + std::strlen(str(name[row])) + 2;
+    generation[row]++;
+    pid[row] = -1;
+    assets.erase(row);
+    cgroup.erase(row);
+    free_rows.push_back(row);
+
+    if (wasted > arena.size() / 2)
+        compact();
+}
+
+// Returns the handle of `file_path`, or an invalid one if not in the table.
+RomHandle RomTable::find(const std::string& file_path) const
+{
+    for (Row row = 0; row < rows(); row++) {
+        if (alive(row) && file_path == str(file[row]))
+            return handle(row);
+    }
+    return {};
+}
+
+/**
+ * @brief Approximates the heap bytes used by the table (columns, arena, pools and assets).
+ */
+size_t RomTable::memory_usage() const
+{
+    size_t bytes = arena.capacity();
+    bytes += (generation.capacity() + file.capacity() + name.capacity()) * sizeof(uint32_t);
+    bytes += free_rows.capacity() * sizeof(Row);
+    bytes += (count.capacity() + time.capacity() + lastsessiontime.capacity()) * sizeof(int32_t);
+    bytes += last.capacity() * sizeof(time_t);
+    bytes += completed.capacity() + favorite.capacity();
+    bytes += pid.capacity() * sizeof(pid_t);
+    bytes += (system.capacity() + launcher.capacity()) * sizeof(uint16_t);
+    bytes += systems.memory_usage() + launchers.memory_usage();
+    for (const auto& entry : assets)
+        bytes += sizeof(entry) + 2 * sizeof(void*) + entry.second.image.capacity() +
+                 entry.second.video.capacity() + entry.second.manual.capacity();
+    bytes += assets.bucket_count() * sizeof(void*);
+    return bytes;
+}
@@ -0,0 +1,293 @@
+#include "SuspendCheck.h"
+
+#include "Config.h"
+#include "SuspendManager.h"
+#include "utils.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+static const char suspend_check_help[] = {
+    "activities suspend-check usage:\n"
+    "\t activities suspend-check [-mb <memory of each game>] [-ipv6]\n"};
+
+/**
+ * @brief Forks a fake game holding `mb` MB in its own process group and cgroup, and adds it to
+ * the roms as running.
+ *
+ * @details With a `socket_fd`, the game stands for RetroArch: it writes each command received on
+ * the socket to its commands pipe, a state file next to its rom on SAVE_STATE, and exits on the
+ * second QUIT, as when quitting asks for a confirmation. An `adopted` game is forked twice so it
+ * is not our child, as games adopted after a restart of the GUI.
+ */
+SuspendCheck::Game SuspendCheck::spawn_game(const std::string& instance, const std::string& name,
+    int mb, int socket_fd, bool adopted)
+{
+    std::string file = instance + "/" + name + ".rom";
+    std::ofstream(file).close();
+    Rom         rom = Rom::add(file);
+    Config&     cfg = Config::getInstance();
+    std::string cgroup =
+        cfg.use_cgroups ? utils::cgroup_create(cfg.cgroup_root, "suspend-check-" + name) : "";
+    if (!cgroup.empty())
+        utils::cgroup_write(cgroup, "cgroup.freeze", "0"); // left frozen by an interrupted check
+
+    int ready[2], commands[2];
+    if (pipe(ready) == -1)
+        return {rom, -1, cgroup, -1};
+    if (pipe(commands) == -1) {
+        close(ready[0]);
+        close(ready[1]);
+        return {rom, -1, cgroup, -1};
+    }
+    pid_t child = fork();
+    if (child == 0) {
+        if (adopted && fork() != 0)
+            _exit(0);
+        setpgid(0, 0);
+        if (!cgroup.empty())
+            utils::cgroup_write(cgroup, "cgroup.procs", "0");
+        size_t         size = static_cast<size_t>(mb) << 20;
+        volatile char* memory = new char[size];
+        for (size_t i = 0; i < size; i += 4096)
+            memory[i] = 1; // resident
+        pid_t pid = getpid();
+        (void) !write(ready[1], &pid, sizeof(pid));
+        close(ready[0]);
+        close(ready[1]);
+        close(commands[0]);
+        if (socket_fd == -1)
+            while (true)
+                pause();
+
+        char command[64];
+        int  quits = 0;
+        while (quits < 2) {
+            ssize_t length = recv(socket_fd, command, sizeof(command), 0);
+            if (length == -1 && errno != EINTR)
+                _exit(1);
+            if (length <= 0)
+                continue;
+            (void) !write(commands[1], command, length);
+            (void) !write(commands[1], "\n", 1);
+            if (std::string(command, length) == "SAVE_STATE")
+                std::ofstream(file + ".state") << std::string(1 << 20, 's');
+            else if (std::string(command, length) == "QUIT")
+                quits++;
+        }
+        _exit(0);
+    }
+    close(ready[1]);
+    close(commands[1]);
+    pid_t pid = -1;
+    if (child != -1 && read(ready[0], &pid, sizeof(pid)) != sizeof(pid))
+        pid = -1;
+    close(ready[0]);
+    if (adopted && child != -1)
+        waitpid(child, nullptr, 0);
+    if (pid == -1) {
+        close(commands[0]);
+        return {rom, -1, cgroup, -1};
+    }
+    fcntl(commands[0], F_SETFL, O_NONBLOCK);
+
+    RomTable& list = Rom::get();
+    list.pid[rom.get_handle().row] = pid;
+    if (!cgroup.empty())
+        list.cgroup[rom.get_handle().row] = cgroup;
+    return {rom, pid, cgroup, commands[0]};
+}
+
+// Suspends `game` as Rom::suspend does, short of the RetroArch hotkey and the system profile.
+void SuspendCheck::suspend(const Game& game)
+{
+    Rom rom = game.rom;
+    rom.freeze();
+    SuspendManager::getInstance().suspended(rom);
+}
+
+// Resumes `game` as Rom::start does.
+void SuspendCheck::resume(const Game& game)
+{
+    Rom rom = game.rom;
+    rom.thaw();
+    SuspendManager::getInstance().resumed(rom);
+}
+
+// Commands received by `game` since the last call, one per line.
+std::string SuspendCheck::commands(const Game& game)
+{
+    std::string received;
+    char        buffer[256];
+    ssize_t     length;
+    while ((length = read(game.commands_fd, buffer, sizeof(buffer))) > 0)
+        received.append(buffer, length);
+    return received;
+}
+
+bool SuspendCheck::expect(bool condition, const std::string& what)
+{
+    std::cout << (condition ? "ok: " : "FAILED: ") << what << std::endl;
+    return condition;
+}
+
+/**
+ * @brief Runs the check, printing each expectation and returning 1 if any is not met.
+ *
+ * @details Three games of about the same size are suspended under a budget fitting two: two
+ * RetroArch games then the other one, the first RetroArch game being resumed and suspended again
+ * in between so the second is the least recently suspended. The budget is then lowered to fit one
+ * game, the first RetroArch game suspended again, and the other game, now the least recently
+ * suspended but unable to save, must be skipped.
+ */
+int SuspendCheck::run(int argc, char** argv)
+{
+    int  mb = 24;
+    bool ipv6 = false;
+    for (int i = 0; i < argc; i++) {
+        if (std::strcmp(argv[i], "-mb") == 0 && i + 1 < argc)
+            mb = atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "-ipv6") == 0)
+            ipv6 = true;
+        else {
+            std::cout << suspend_check_help << std::endl;
+            return 1;
+        }
+    }
+
+    char instance[] = "/tmp/suspend-check-XXXXXX";
+    if (!mkdtemp(instance)) {
+        std::cerr << "Suspend check: Could not create the instance" << std::endl;
+        return 1;
+    }
+    setenv(INSTANCE_ENV, instance, 1);
+    Config& cfg = Config::getInstance();
+    cfg.suspend_pageout = false;
+    cfg.suspended_memory_budget_mb = 0; // set once the games measured
+
+    // Spawned first, not to inherit the socket
+    std::vector<Game> games = {spawn_game(instance, "other", mb, -1, false)};
+
+    // Shared by both RetroArch games: the one thawed by evict() receives the commands
+    int                     socket_fd = socket(ipv6 ? AF_INET6 : AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_storage addr = {};
+    socklen_t               length;
+    if (ipv6) {
+        struct sockaddr_in6* addr6 = reinterpret_cast<struct sockaddr_in6*>(&addr);
+        addr6->sin6_family = AF_INET6;
+        addr6->sin6_port = htons(cfg.retroarch_cmd_port);
+        addr6->sin6_addr = in6addr_loopback;
+        length = sizeof(*addr6);
+    } else {
+        struct sockaddr_in* addr4 = reinterpret_cast<struct sockaddr_in*>(&addr);
+        addr4->sin_family = AF_INET;
+        addr4->sin_port = htons(cfg.retroarch_cmd_port);
+        addr4->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        length = sizeof(*addr4);
+    }
+    bool passed = true;
+    if (socket_fd == -1 ||
+        bind(socket_fd, reinterpret_cast<struct sockaddr*>(&addr), length) == -1) {
+        std::cerr << "Suspend check: Could not bind the port " << cfg.retroarch_cmd_port << ": "
+                  << strerror(errno) << std::endl;
+        passed = false;
+    } else {
+        games.push_back(spawn_game(instance, "retroarch-1", mb, socket_fd, false));
+        games.push_back(spawn_game(instance, "retroarch-2", mb, socket_fd, true));
+    }
+    if (socket_fd != -1)
+        close(socket_fd);
+
+    size_t rss = 0;
+    for (const Game& game : games) {
+        passed = game.pid != -1 && passed;
+        rss += utils::get_process_group_rss(game.pid);
+    }
+    if (!passed || games.size() != 3) {
+        std::cerr << "Suspend check: Could not start the games" << std::endl;
+        passed = false;
+    }
+    cfg.suspended_memory_budget_mb = (rss * 5 / 6) >> 20; // two games and a half
+    std::cout << "Suspend check: " << games.size() << " games of "
+              << rss / games.size() / 1024 << " kB, budget "
+              << cfg.suspended_memory_budget_mb * 1024 << " kB, "
+              << (games[0].cgroup.empty() ? "signals" : "cgroup freezer") << ", "
+              << (ipv6 ? "IPv6" : "IPv4") << " command port" << std::endl;
+
+    SuspendManager& manager = SuspendManager::getInstance();
+    typedef std::list<RomHandle> Order;
+    if (passed) {
+        const Game& other = games[0];
+        const Game& first = games[1];
+        const Game& second = games[2];
+        suspend(first);
+        suspend(second);
+        passed = expect(first.rom.pid() == first.pid && second.rom.pid() == second.pid &&
+                            commands(first).empty() && commands(second).empty(),
+                     "two games within the budget are left suspended") &&
+                 passed;
+        resume(first);
+        suspend(first);
+        passed = expect(manager.suspended_roms ==
+                            Order{second.rom.get_handle(), first.rom.get_handle()},
+                     "a game suspended again becomes the most recently suspended") &&
+                 passed;
+
+        Uint32 start = SDL_GetTicks();
+        suspend(other);
+        Uint32 elapsed = SDL_GetTicks() - start;
+        passed = expect(second.rom.pid() == -1,
+                     "over the budget, the least recently suspended game is evicted") &&
+                 passed;
+        passed = expect(commands(second) == "SAVE_STATE\nQUIT\nQUIT\n",
+                     "it was sent SAVE_STATE then QUIT") &&
+                 passed;
+        passed = expect(elapsed < EVICT_SAVE_TIMEOUT_MS,
+                     "not being our child, it was seen saving and quitting in " +
+                         std::to_string(elapsed) + " ms") &&
+                 passed;
+        passed = expect(first.rom.pid() == first.pid && other.rom.pid() == other.pid &&
+                            commands(first).empty() &&
+                            manager.suspended_roms ==
+                                Order{first.rom.get_handle(), other.rom.get_handle()},
+                     "back within the budget, the others are left suspended") &&
+                 passed;
+
+        cfg.suspended_memory_budget_mb = (rss / 2) >> 20; // one game and a half
+        resume(first);
+        start = SDL_GetTicks();
+        suspend(first);
+        elapsed = SDL_GetTicks() - start;
+        passed = expect(other.rom.pid() == other.pid && first.rom.pid() == -1 &&
+                            commands(first) == "SAVE_STATE\nQUIT\nQUIT\n" &&
+                            manager.suspended_roms == Order{other.rom.get_handle()},
+                     "a game not owning the command port is skipped for the next one") &&
+                 passed;
+        passed = expect(elapsed < EVICT_SAVE_TIMEOUT_MS,
+                     "being our child, it was seen saving and quitting in " +
+                         std::to_string(elapsed) + " ms") &&
+                 passed;
+    }
+
+    // Thawed and terminated as on GUI exit, then their cgroups removed
+    for (const Game& game : games) {
+        if (game.pid == -1)
+            continue;
+        if (game.rom.pid() != -1)
+            Rom(game.rom).stop();
+        waitpid(game.pid, nullptr, 0);
+        close(game.commands_fd);
+    }
+    Rom::remove_cgroups();
+    unsetenv(INSTANCE_ENV);
+    fs::remove_all(instance);
+
+    std::cout << "Suspend check " << (passed ? "passed" : "failed") << std::endl;
+    return passed ? 0 : 1;
+}
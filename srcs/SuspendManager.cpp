@@ -0,0 +1,229 @@
+#include "SuspendManager.h"
+
+#include "utils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <poll.h>
+#include <sys/wait.h>
+#include <thread>
+
+SuspendManager::SuspendManager()
+    : cfg(Config::getInstance())
+    , gui(GUI::getInstance())
+{
+}
+
+// Records `rom` as the most recently suspended game, then enforces the budget.
+void SuspendManager::suspended(const Rom& rom)
+{
+    suspended_roms.remove(rom.get_handle());
+    suspended_roms.push_back(rom.get_handle());
+    if (cfg.suspend_pageout)
+        page_out(rom);
+    enforce_budget();
+}
+
+// Stops tracking `rom` as suspended and, if it was paged out, starts measuring its resume.
+void SuspendManager::resumed(const Rom& rom)
+{
+    forget(rom);
+    pid_t pid = rom.pid();
+    if (pid == -1 || std::find(paged_out_roms.begin(), paged_out_roms.end(), rom.get_handle()) ==
+                         paged_out_roms.end())
+        return;
+    paged_out_roms.remove(rom.get_handle());
+    unsigned long majflt = utils::get_process_group_majflt(pid);
+    resuming[rom.get_handle().row] = {
+        rom.get_handle(), SDL_GetTicks(), utils::get_process_group_rss(pid), majflt, majflt};
+}
+
+// Stops tracking `rom` (resumed, stopped or exited).
+void SuspendManager::forget(const Rom& rom)
+{
+    suspended_roms.remove(rom.get_handle());
+    paged_out_roms.remove(rom.get_handle());
+    resuming.erase(rom.get_handle().row);
+}
+
+/**
+ * @brief Measures the resume of a paged out game, called periodically while it runs.
+ *
+ * @details The resume is considered over once a sample, after the first 300 ms, sees no new major
+ * page fault, or after 10 seconds. The time taken, the pages faulted back in and the memory
+ * regained are then logged.
+ *
+ * @return true while the measure is still going on.
+ */
+bool SuspendManager::sample_resume(const Rom& rom)
+{
+    if (resuming.empty())
+        return false;
+    auto it = resuming.find(rom.get_handle().row);
+    if (it == resuming.end())
+        return false;
+    ResumeSample& sample = it->second;
+    if (sample.handle != rom.get_handle() || rom.pid() == -1) {
+        resuming.erase(it);
+        return false;
+    }
+
+    unsigned long majflt = utils::get_process_group_majflt(rom.pid());
+    Uint32        elapsed = SDL_GetTicks() - sample.start;
+    if ((majflt != sample.last_majflt || elapsed < 300) && elapsed < 10000) {
+        sample.last_majflt = majflt;
+        return true;
+    }
+    std::cout << "SuspendManager: " << rom.name() << " resumed from page-out in " << elapsed
+              << " ms, " << majflt - sample.majflt << " major faults, RSS "
+              << sample.rss / 1024 << " -> " << utils::get_process_group_rss(rom.pid()) / 1024
+              << " kB" << std::endl;
+    resuming.erase(it);
+    return false;
+}
+
+/**
+ * @brief Pages out the anonymous memory of a suspended game from a detached thread, so the GUI
+ * is not blocked while the kernel compresses or writes it.
+ */
+void SuspendManager::page_out(const Rom& rom)
+{
+    paged_out_roms.remove(rom.get_handle());
+    paged_out_roms.push_back(rom.get_handle());
+
+    pid_t       pid = rom.pid();
+    std::string name = rom.name();
+    std::thread([pid, name]() {
+        auto   start = std::chrono::steady_clock::now();
+        size_t rss = utils::get_process_group_rss(pid);
+        if (!utils::page_out_process_group(pid))
+            return;
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+        std::cout << "SuspendManager: " << name << " paged out in " << elapsed.count()
+                  << " ms, RSS " << rss / 1024 << " -> " << utils::get_process_group_rss(pid) / 1024
+                  << " kB" << std::endl;
+    }).detach();
+}
+
+// Resident memory, in bytes, of every suspended game.
+size_t SuspendManager::memory_usage() const
+{
+    size_t rss = 0;
+    for (RomHandle handle : suspended_roms) {
+        Rom rom(handle);
+        if (rom.valid() && rom.pid() != -1)
+            rss += utils::get_process_group_rss(rom.pid());
+    }
+    return rss;
+}
+
+/**
+ * @brief Evicts the least recently suspended games until their memory fits in the budget.
+ *
+ * @details Only games owning the RetroArch command port can save their state, so the others are
+ * skipped and never closed. A budget of 0 disables the eviction.
+ */
+void SuspendManager::enforce_budget()
+{
+    if (cfg.suspended_memory_budget_mb <= 0)
+        return;
+    size_t budget = static_cast<size_t>(cfg.suspended_memory_budget_mb) * 1024 * 1024;
+
+    std::list<RomHandle> candidates = suspended_roms;
+    size_t               rss = memory_usage();
+    for (RomHandle handle : candidates) {
+        if (rss <= budget)
+            break;
+        Rom rom(handle);
+        if (!rom.valid() || rom.pid() == -1) {
+            suspended_roms.remove(handle);
+            continue;
+        }
+        size_t rom_rss = utils::get_process_group_rss(rom.pid());
+        std::cout << "SuspendManager: " << rss / 1024 << " kB suspended over " << budget / 1024
+                  << " kB, evicting " << rom.name() << " (" << rom_rss / 1024 << " kB)"
+                  << std::endl;
+        if (evict(rom))
+            rss -= std::min(rss, rom_rss);
+    }
+}
+
+// Waits up to `timeout_ms` for the game to write its state: for its writes to start then settle.
+static bool wait_saved(pid_t pid, unsigned long long before, Uint32 timeout_ms)
+{
+    Uint32             start = SDL_GetTicks();
+    unsigned long long written = before;
+    while (SDL_GetTicks() - start < timeout_ms) {
+        SDL_Delay(100);
+        unsigned long long now = utils::get_process_group_write_bytes(pid);
+        if (now != before && now == written)
+            return true;
+        written = now;
+    }
+    return false;
+}
+
+/**
+ * @brief Waits up to `timeout_ms` for the game to exit.
+ *
+ * @details Adopted games are not our children and so cannot be waited for: their pidfd becoming
+ * readable, or their pid vanishing without pidfd, tells they exited.
+ */
+static bool wait_exited(pid_t pid, Uint32 timeout_ms)
+{
+    int           pidfd = utils::pidfd_open(pid);
+    struct pollfd fds = {pidfd, POLLIN, 0}; // poll() ignores negative fds
+    Uint32        start = SDL_GetTicks();
+    bool          exited = false;
+    while (!exited && SDL_GetTicks() - start < timeout_ms) {
+        poll(&fds, 1, 100);
+        pid_t result = waitpid(pid, nullptr, WNOHANG);
+        if (result == pid)
+            exited = true;
+        else if (result == -1 && errno == ECHILD)
+            exited = pidfd != -1 ? fds.revents != 0 : kill(pid, 0) == -1 && errno == ESRCH;
+    }
+    if (pidfd != -1)
+        close(pidfd);
+    return exited;
+}
+
+/**
+ * @brief Saves the state of a suspended RetroArch game and closes it.
+ *
+ * @details The game is resumed to process SAVE_STATE. RetroArch does not acknowledge commands, so
+ * QUIT (sent twice, in case quitting asks for confirmation) only follows once the writes of the
+ * game settled, or after EVICT_SAVE_TIMEOUT_MS. If it does not exit within EVICT_QUIT_TIMEOUT_MS
+ * it is terminated.
+ *
+ * @return false if the game does not own the command port and so was left suspended.
+ */
+bool SuspendManager::evict(Rom rom)
+{
+    pid_t pid = rom.pid();
+    int   family = AF_INET;
+    if (!utils::process_group_owns_udp_port(pid, cfg.retroarch_cmd_port, &family)) {
+        std::cout << "SuspendManager: " << rom.name() << " does not listen on port "
+                  << cfg.retroarch_cmd_port << ", cannot save it" << std::endl;
+        return false;
+    }
+    gui.message_popup(15, {{"Please wait...", 32, cfg.title_color},
+                              {"Saving " + rom.name() + " to free memory.", 18, cfg.title_color}});
+
+    rom.thaw();
+    unsigned long long written = utils::get_process_group_write_bytes(pid);
+    utils::send_udp_command(cfg.retroarch_cmd_port, "SAVE_STATE", family);
+    if (!wait_saved(pid, written, EVICT_SAVE_TIMEOUT_MS))
+        std::cerr << "SuspendManager: " << rom.name() << " wrote no state, quitting it anyway"
+                  << std::endl;
+    utils::send_udp_command(cfg.retroarch_cmd_port, "QUIT", family);
+    utils::send_udp_command(cfg.retroarch_cmd_port, "QUIT", family);
+
+    if (!wait_exited(pid, EVICT_QUIT_TIMEOUT_MS))
+        std::cerr << "SuspendManager: " << rom.name() << " did not quit, terminating it"
+                  << std::endl;
+    rom.stop(); // also drops it from autostarts.txt
+    return true;
+}
@@ -0,0 +1,272 @@
+#include "SystemProfile.h"
+
+#include "utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+SystemProfile::SystemProfile()
+    : cfg(Config::getInstance())
+{
+    gui_nice = getpriority(PRIO_PROCESS, 0);
+    sched_getaffinity(0, sizeof(gui_cpus), &gui_cpus);
+}
+
+static std::string read_value(const std::string& path)
+{
+    std::ifstream file(path);
+    std::string   value;
+    std::getline(file, value);
+    return value;
+}
+
+static void write_value(const std::string& path, const std::string& value)
+{
+    if (value.empty())
+        return;
+    std::ofstream file(path);
+    file << value << std::flush;
+    if (!file.good())
+        std::cerr << "SystemProfile: could not write " << value << " to " << path << std::endl;
+}
+
+std::string SystemProfile::cpu_path(size_t cpu) const
+{
+    return cfg.cpufreq_root + "/cpu" + std::to_string(cpu);
+}
+
+size_t SystemProfile::cpu_count() const
+{
+    struct stat st;
+    size_t      count = 0;
+    while (stat(cpu_path(count).c_str(), &st) == 0)
+        count++;
+    return count;
+}
+
+CpuState SystemProfile::read_cpu(size_t cpu) const
+{
+    std::string path = cpu_path(cpu);
+    return {read_value(path + "/online"), read_value(path + "/cpufreq/scaling_governor"),
+        read_value(path + "/cpufreq/scaling_min_freq"),
+        read_value(path + "/cpufreq/scaling_max_freq")};
+}
+
+void SystemProfile::write_cpu(size_t cpu, const CpuState& state) const
+{
+    std::string path = cpu_path(cpu);
+    if (cpu > 0)
+        write_value(path + "/online", state.online);
+    if (read_value(path + "/online") == "0")
+        return;
+    write_value(path + "/cpufreq/scaling_governor", state.governor);
+    // Keep min <= max at each step
+    std::string current_max = read_value(path + "/cpufreq/scaling_max_freq");
+    if (!state.min_freq.empty() && !current_max.empty() &&
+        atol(state.min_freq.c_str()) > atol(current_max.c_str())) {
+        write_value(path + "/cpufreq/scaling_max_freq", state.max_freq);
+        write_value(path + "/cpufreq/scaling_min_freq", state.min_freq);
+    } else {
+        write_value(path + "/cpufreq/scaling_min_freq", state.min_freq);
+        write_value(path + "/cpufreq/scaling_max_freq", state.max_freq);
+    }
+}
+
+// Battery level in percent, -1 if unknown.
+int SystemProfile::battery_capacity() const
+{
+    std::string capacity = read_value(cfg.battery_path + "/capacity");
+    return capacity.empty() ? -1 : atoi(capacity.c_str());
+}
+
+// Instant power drawn from the battery in watts, 0 if unknown.
+double SystemProfile::battery_power() const
+{
+    std::string voltage = read_value(cfg.battery_path + "/voltage_now"); // uV
+    std::string current = read_value(cfg.battery_path + "/current_now"); // uA
+    if (voltage.empty() || current.empty())
+        return 0;
+    return std::abs(atof(voltage.c_str()) * atof(current.c_str())) / 1e12;
+}
+
+// Nice value given to the games of `system`.
+int SystemProfile::game_nice(const std::string& system) const
+{
+    return cfg.get_int_setting("game_nice." + system, cfg.game_nice);
+}
+
+// Cpus given to the games of `system`, those of the GUI before any game when not set.
+cpu_set_t SystemProfile::game_cpus(const std::string& system) const
+{
+    cpu_set_t   cpus;
+    std::string list = cfg.get_setting("game_cpus." + system, cfg.game_cpus);
+    if (list.empty() || !utils::parse_cpu_list(list, cpus))
+        cpus = gui_cpus;
+    return cpus;
+}
+
+/**
+ * @brief Gives the processes of the group `pgid` the nice value and cpus of `system`, its helpers
+ * being moved to SCHED_BATCH.
+ *
+ * @details Helpers are only demoted once the group runs something else: right after launch the
+ * launch script is alone and the emulator it forks would inherit its policy. SCHED_RESET_ON_FORK
+ * covers the processes it starts later.
+ *
+ * @return Whether the group ran something else than helpers.
+ */
+bool SystemProfile::schedule_game(const std::string& system, pid_t pgid) const
+{
+    std::vector<std::string> helpers;
+    std::istringstream       stream(cfg.helper_processes);
+    std::string              helper;
+    while (std::getline(stream, helper, ','))
+        helpers.push_back(helper);
+
+    std::vector<pid_t> pids = utils::get_process_group_pids(pgid);
+    std::vector<bool>  is_helper;
+    for (pid_t pid : pids) {
+        std::string name = utils::get_process_name(pid);
+        is_helper.push_back(std::find(helpers.begin(), helpers.end(), name) != helpers.end());
+    }
+    bool      has_game = std::find(is_helper.begin(), is_helper.end(), false) != is_helper.end();
+    int       nice = game_nice(system);
+    cpu_set_t cpus = game_cpus(system);
+    for (size_t i = 0; i < pids.size(); i++) {
+        utils::set_process_affinity(pids[i], cpus);
+        if (is_helper[i] && has_game)
+            utils::set_process_batch(pids[i]);
+        else
+            utils::set_process_nice(pids[i], nice);
+    }
+    return has_game;
+}
+
+/**
+ * @brief Sets up the cpus and the scheduling for the game of `new_system` in the group `pgid`,
+ * and steps the GUI back.
+ */
+void SystemProfile::apply(const std::string& new_system, pid_t pgid)
+{
+    apply_cpu_profile(new_system);
+    pending_pgid = schedule_game(new_system, pgid) ? -1 : pgid;
+    pending_system = new_system;
+    pending_since = std::chrono::steady_clock::now();
+
+    utils::set_process_nice(getpid(), cfg.gui_nice);
+    cpu_set_t cpus;
+    if (!cfg.gui_cpus.empty() && utils::parse_cpu_list(cfg.gui_cpus, cpus))
+        utils::set_process_affinity(getpid(), cpus);
+    gui_in_background = true;
+}
+
+/**
+ * @brief Schedules the game applied right after its launch again, once its group runs more than
+ * the launch script, so the helpers get demoted on a first launch too.
+ *
+ * @details Called from the wait loop of the game, given up after SCHEDULE_PENDING_S.
+ *
+ * @return true while the game is still to be scheduled.
+ */
+bool SystemProfile::schedule_pending()
+{
+    if (pending_pgid == -1)
+        return false;
+    if (schedule_game(pending_system, pending_pgid) ||
+        std::chrono::steady_clock::now() - pending_since > std::chrono::seconds(SCHEDULE_PENDING_S))
+        pending_pgid = -1;
+    return pending_pgid != -1;
+}
+
+/**
+ * @brief Brings the cpus and the GUI scheduling back to their state before any game.
+ */
+void SystemProfile::restore()
+{
+    pending_pgid = -1;
+    restore_cpu_profile();
+    if (!gui_in_background)
+        return;
+    utils::set_process_nice(getpid(), gui_nice);
+    utils::set_process_affinity(getpid(), gui_cpus);
+    gui_in_background = false;
+}
+
+/**
+ * @brief Applies the profile of `new_system`, if any, to every cpu.
+ *
+ * @details The cpus are saved the first time so `restore` brings them back to their state before
+ * any game. Cores beyond `online_cores` are put offline, the first ones online.
+ */
+void SystemProfile::apply_cpu_profile(const std::string& new_system)
+{
+    std::string profile = cfg.get_setting("cpu_profile." + new_system);
+    if (profile.empty())
+        profile = cfg.get_setting("cpu_profile.default");
+    if (profile.empty()) {
+        restore_cpu_profile();
+        return;
+    }
+    if (!saved.empty() && system == new_system)
+        return;
+
+    std::vector<std::string> fields;
+    std::istringstream       stream(profile);
+    std::string              field;
+    while (std::getline(stream, field, ','))
+        fields.push_back(field);
+    fields.resize(4);
+
+    size_t count = cpu_count();
+    if (saved.empty()) {
+        for (size_t cpu = 0; cpu < count; cpu++)
+            saved.push_back(read_cpu(cpu));
+        battery_start = battery_capacity();
+        start = std::chrono::steady_clock::now();
+    }
+    system = new_system;
+
+    size_t online = fields[3].empty() ? count : strtoul(fields[3].c_str(), nullptr, 10);
+    for (size_t cpu = 0; cpu < count; cpu++) {
+        if (cpu < online)
+            write_cpu(cpu, {"1", fields[0], fields[1], fields[2]});
+        else
+            write_cpu(cpu, {"0", "", "", ""});
+    }
+    std::cout << "SystemProfile: " << system << " profile applied (" << profile << ")"
+              << std::endl;
+}
+
+/**
+ * @brief Writes back the cpus state saved by `apply` and logs the playtime per battery percent
+ * spent under the profile.
+ */
+void SystemProfile::restore_cpu_profile()
+{
+    if (saved.empty())
+        return;
+    for (size_t cpu = 0; cpu < saved.size(); cpu++)
+        write_cpu(cpu, saved[cpu]);
+
+    auto seconds =
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - start)
+            .count();
+    int battery_end = battery_capacity();
+    std::cout << "SystemProfile: " << system << " profile restored after " << seconds << " s";
+    if (battery_start != -1 && battery_end != -1) {
+        int used = battery_start - battery_end;
+        std::cout << ", battery " << battery_start << "% -> " << battery_end << "%";
+        if (used > 0)
+            std::cout << " (" << seconds / used << " s played per %)";
+    }
+    double power = battery_power();
+    if (power > 0)
+        std::cout << ", drawing " << power << " W";
+    std::cout << std::endl;
+    saved.clear();
+}
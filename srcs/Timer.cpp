@@ -1,173 +1,415 @@
 #include "Timer.h"
 
+#include "Config.h"
 #include "Rom.h"
+#include "utils.h"
 
+#include <algorithm>
+#include <climits>
+#include <csignal>
+#include <cstring>
+#include <fstream>
 #include <iostream>
-#include <ostream>
-#include <sys/select.h>
+#include <linux/input.h>
+#include <sstream>
+#include <sys/ioctl.h>
 
-Timer::Timer(const std::string& pid)
-    : running(true)
+Timer::Timer(pid_t pid)
+    : since_ms(clock_ms(CLOCK_MONOTONIC))
+    , since_boot_ms(clock_ms(CLOCK_BOOTTIME))
+    , next_check_ms(since_ms)
 {
-    std::string stat_path = "/proc/" + pid + "/stat";
-    fd = open(stat_path.c_str(), O_RDONLY);
+    std::string stat_path = "/proc/" + std::to_string(pid) + "/stat";
+    fd = open(stat_path.c_str(), O_RDONLY | O_CLOEXEC);
     if (fd == -1) {
         std::cerr << "Failed to open" << stat_path << std::endl;
         return;
     }
+
+    // A frozen cgroup does not show in the process state, watch its cgroup.events instead.
+    std::string cgroup = utils::get_process_cgroup(pid);
+    if (cgroup.compare(0, 12, "/activities/") == 0) {
+        std::string events = Config::getInstance().cgroup_root + cgroup + "/cgroup.events";
+        events_fd = open(events.c_str(), O_RDONLY | O_CLOEXEC);
+        // Timed from inside the game cgroup, the freezes would stop the timer too and go unseen
+        if (utils::get_process_cgroup(getpid()) == cgroup &&
+            !utils::cgroup_leave(Config::getInstance().cgroup_root, "timerd"))
+            std::cerr << "Timer: Could not leave the cgroup " << cgroup << std::endl;
+    }
+    pidfd = utils::pidfd_open(pid);
+
+    // CPU time of all the processes of the game, when in a cgroup
+    if (events_fd != -1) {
+        std::string cpu_stat = Config::getInstance().cgroup_root + cgroup + "/cpu.stat";
+        cpu_fd = open(cpu_stat.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+    std::string proc = "/proc/" + std::to_string(pid);
+    status_fd = open((proc + "/status").c_str(), O_RDONLY | O_CLOEXEC);
+    io_fd = open((proc + "/io").c_str(), O_RDONLY | O_CLOEXEC);
+    if (Config::getInstance().idle_timeout_s > 0)
+        open_input();
 }
 
 Timer::~Timer()
 {
     if (fd != -1)
         close(fd);
+    if (events_fd != -1)
+        close(events_fd);
+    if (pidfd != -1)
+        close(pidfd);
+    if (input_fd != -1)
+        close(input_fd);
+    for (int file : {cpu_fd, status_fd, io_fd})
+        if (file != -1)
+            close(file);
 }
 
-// Daemonize the timer to avoid it being killed before it saves time.
-void Timer::daemonize(const std::string& rom_file, const std::string& program_pid)
+// Opens the gamepad for idle tracking, along with the rest position of its sticks.
+void Timer::open_input()
 {
-    int pipe_fd[2];
-    if (pipe(pipe_fd) == -1) {
-        std::cerr << "Failed to create pipe" << std::endl;
-        exit(1);
+    input_fd = utils::open_gamepad_evdev("");
+    if (input_fd == -1) {
+        std::cerr << "Timer: No gamepad found, idle time not tracked" << std::endl;
+        return;
     }
-
-    // Fork to create a detached process
-    pid_t pid = fork();
-    if (pid < 0) {
-        std::cerr << "Failed to fork" << std::endl;
-        exit(1);
+    input_ms = since_ms;
+    for (int axis = 0; axis < TIMER_AXES; axis++) {
+        struct input_absinfo info;
+        bool                 found = ioctl(input_fd, EVIOCGABS(ABS_X + axis), &info) == 0;
+        axis_rest[axis] = found ? info.value : 0;
+        // A third of the range away from rest, above the noise of the sticks
+        axis_threshold[axis] = found && info.maximum > info.minimum
+                                   ? (info.maximum - info.minimum) / 3
+                                   : INT_MAX;
     }
+}
 
-    if (pid > 0) {
-        close(pipe_fd[1]);
+// CPU time of the cgroup in ms, from the "usage_usec" line of its cpu.stat.
+static long long cgroup_cpu_ms(int cpu_fd)
+{
+    char    buffer[256];
+    ssize_t bytes_read = pread(cpu_fd, buffer, sizeof(buffer) - 1, 0);
+    if (bytes_read <= 0)
+        return -1;
+    buffer[bytes_read] = '\0';
+    const char* usage = strstr(buffer, "usage_usec ");
+    return usage ? atoll(usage + 11) / 1000 : -1;
+}
 
-        // Original process just waits for the daemon to terminate
-        char buffer[1];
-        while (read(pipe_fd[0], buffer, 1) > 0) {
+/**
+ * @brief Whether the game was played over the last `delta_ms`: input within `idle_timeout_s` and
+ * some CPU used.
+ *
+ * @details The input events queued since the previous call are drained here: buttons, d-pad and
+ * sticks pushed away from rest.
+ */
+bool Timer::played(long long delta_ms, long long cpu_now_ms, long long now_ms)
+{
+    struct input_event events[64];
+    ssize_t            bytes_read;
+    while ((bytes_read = read(input_fd, events, sizeof(events))) > 0) {
+        for (size_t i = 0; i < bytes_read / sizeof(struct input_event); i++) {
+            const struct input_event& event = events[i];
+            int                       axis = event.code - ABS_X;
+            if (event.type == EV_KEY ||
+                (event.type == EV_ABS && (event.code == ABS_HAT0X || event.code == ABS_HAT0Y)) ||
+                (event.type == EV_ABS && axis >= 0 && axis < TIMER_AXES &&
+                    std::abs(event.value - axis_rest[axis]) > axis_threshold[axis]))
+                input_ms = now_ms;
         }
-        close(pipe_fd[0]);
-
-        waitpid(pid, nullptr, 0);
-        return;
     }
 
-    close(pipe_fd[0]);
+    const Config& cfg = Config::getInstance();
+    bool          busy = cpu_ms == -1 || cpu_now_ms == -1 || delta_ms <= 0 ||
+                (cpu_now_ms - cpu_ms) * 100 >= cfg.idle_cpu_percent * delta_ms;
+    return busy && now_ms - input_ms <= cfg.idle_timeout_s * 1000LL;
+}
 
-    // Leave the original session
-    if (setsid() == -1) {
-        std::cerr << "Failed to start new session" << std::endl;
-        exit(1);
-    }
+// Whether the game cgroup is frozen, read from the "frozen 0|1" line of cgroup.events.
+static bool is_frozen(int events_fd)
+{
+    char    buffer[128];
+    ssize_t bytes_read = pread(events_fd, buffer, sizeof(buffer) - 1, 0);
+    if (bytes_read <= 0)
+        return false;
+    buffer[bytes_read] = '\0';
+    const char* frozen = strstr(buffer, "frozen ");
+    return frozen && frozen[7] == '1';
+}
 
-    // Create the daemon process
-    pid = fork();
-    if (pid < 0) {
-        std::cerr << "Failed to fork again" << std::endl;
-        exit(1);
-    }
-    if (pid > 0) {
-        exit(0);
-    }
+/**
+ * @brief State of the game: 'T' when stopped or frozen, 'Z' or 0 once exited, else its
+ * /proc/<pid>/stat state.
+ */
+char Timer::state(long long* cpu_ticks)
+{
+    char    buffer[256];
+    ssize_t bytes_read = pread(fd, buffer, sizeof(buffer) - 1, 0);
+    if (bytes_read <= 0)
+        return 0;
+    buffer[bytes_read] = '\0';
+    // The state follows the command, which is in parentheses and may contain spaces
+    const char* end = strrchr(buffer, ')');
+    if (!end || end[1] != ' ')
+        return 0;
+    // utime and stime, 11 fields after the state
+    unsigned long long utime, stime;
+    if (cpu_ticks && sscanf(end + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu",
+                         &utime, &stime) == 2)
+        *cpu_ticks = utime + stime;
+    // A game killed while frozen leaves its cgroup frozen
+    if (end[2] != 'Z' && events_fd != -1 && is_frozen(events_fd))
+        return 'T';
+    return end[2];
+}
 
-    int logfile =
-        open("/mnt/SDCARD/Apps/Activities/log/timer.log", O_WRONLY | O_CREAT | O_APPEND, 0644);
-    dup2(logfile, STDOUT_FILENO);
-    dup2(logfile, STDERR_FILENO);
-    close(logfile);
+long long Timer::clock_ms(clockid_t clock)
+{
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return now.tv_sec * 1000LL + now.tv_nsec / 1000000;
+}
 
-    int devnull = open("/dev/null", O_RDWR);
-    if (devnull != -1) {
-        dup2(devnull, STDIN_FILENO);
-        close(devnull);
-    }
+// Value of the `key` line of a /proc file such as "VmHWM:  1234 kB", -1 if not found.
+static long long proc_value(int file, const char* key)
+{
+    char    buffer[2048];
+    ssize_t bytes_read = file != -1 ? pread(file, buffer, sizeof(buffer) - 1, 0) : -1;
+    if (bytes_read <= 0)
+        return -1;
+    buffer[bytes_read] = '\0';
+    const char* line = strstr(buffer, key);
+    return line ? atoll(line + strlen(key)) : -1;
+}
 
-    long duration = -1;
-    // a negative duration mean session end with game beeing suspended.
-    Timer& timer = Timer::getInstance(program_pid);
-    while (duration < 0) {
-        duration = timer.run();
-        if (std::abs(duration) >= 30) {
-            Rom rom(rom_file, std::abs(duration));
-            rom.save();
-        }
+// Samples the peak RSS and storage reads of the game, which are only lost once it is reaped.
+void Timer::sample_resources()
+{
+    long long peak = proc_value(status_fd, "VmHWM:");
+    if (peak != -1)
+        peak_rss_kb = static_cast<long>(peak);
+    long long read_bytes = proc_value(io_fd, "read_bytes:");
+    if (read_bytes != -1) {
+        read_kb = read_bytes / 1024;
+        if (session_read_kb == -1)
+            session_read_kb = read_kb;
     }
+}
 
-    // Notify the original process that saving is finished
-    close(pipe_fd[1]);
+// Makes the profile of the session of `seconds` that ends, the next one starting from there.
+void Timer::end_profile(long seconds)
+{
+    ended_profile.cpu_percent = session_cpu_ms != -1 && seconds > 0
+                                    ? static_cast<int>((cpu_ms - session_cpu_ms) / (seconds * 10))
+                                    : -1;
+    ended_profile.peak_rss_kb = peak_rss_kb;
+    ended_profile.read_kb = session_read_kb != -1 ? read_kb - session_read_kb : -1;
+    session_cpu_ms = cpu_ms;
+    session_read_kb = read_kb;
 }
 
-void Timer::timer_handler(int signum)
+// Milliseconds timed and not yet returned by `update`, including those since its last call.
+long long Timer::elapsed() const
 {
-    Timer& instance = Timer::getInstance();
-    (void) signum;
-    if (!instance.running)
-        return;
+    if (!running())
+        return elapsed_ms;
+    return elapsed_ms + clock_ms(CLOCK_MONOTONIC) - since_ms;
+}
 
-    if (lseek(instance.fd, 0, SEEK_SET) == -1) {
-        instance.running = false;
-        return;
+// Milliseconds until `update` is due, -1 when only the fds tell it.
+int Timer::timeout() const
+{
+    if (has_exited)
+        return -1;
+    long long due_ms = pidfd != -1 && events_fd != -1 ? -1 : next_check_ms;
+    if (running()) {
+        if (input_fd != -1 && (due_ms == -1 || next_sample_ms < due_ms))
+            due_ms = next_sample_ms;
+        if (due_ms == -1 || next_profile_ms < due_ms)
+            due_ms = next_profile_ms;
     }
-    char    buffer[128];
-    ssize_t bytes_read = read(instance.fd, buffer, sizeof(buffer) - 1);
-    if (bytes_read <= 0) {
-        instance.running = false;
-        return;
+    if (due_ms == -1)
+        return -1;
+    return static_cast<int>(std::max(0LL, due_ms - clock_ms(CLOCK_MONOTONIC)));
+}
+
+/**
+ * @brief Accounts the time since the previous call and checks the state of the game.
+ *
+ * @details A session ends when the game exits, or when it is stopped after running more than
+ * 30 s. Shorter runs keep adding up across stops so brief pauses do not make sessions.
+ *
+ * @return The seconds of the session that just ended, negative if the game was only stopped, or
+ * 0 while it goes on.
+ */
+long Timer::update()
+{
+    static const long ticks_per_second = sysconf(_SC_CLK_TCK);
+    long long         cpu_ticks = -1;
+    char              current = state(cpu_fd == -1 ? &cpu_ticks : nullptr);
+    long long         now_ms = clock_ms(CLOCK_MONOTONIC);
+    long long         now_boot_ms = clock_ms(CLOCK_BOOTTIME);
+    long long         sleep_ms = (now_boot_ms - since_boot_ms) - (now_ms - since_ms);
+    long long         cpu_now_ms = cpu_fd != -1    ? cgroup_cpu_ms(cpu_fd)
+                                   : cpu_ticks != -1 ? cpu_ticks * 1000 / ticks_per_second
+                                                     : -1;
+    if (input_fd != -1) {
+        if (previous && previous != 'T' && !played(now_ms - since_ms, cpu_now_ms, now_ms))
+            idle_ms += now_ms - since_ms;
+        next_sample_ms = now_ms + TIMER_IDLE_SAMPLE_MS;
     }
-    int space_count = 0;
-    for (ssize_t i = 0; i < bytes_read; i++) {
-        if (buffer[i] == ' ')
-            space_count++;
-        if (space_count == 2 && ++i < bytes_read) {
-            switch (buffer[i]) {
-            case 'Z': instance.running = false; return;
-            case 'T':
-                // Keep sum session between sleep until 30 seconds min are reached.
-                if (instance.elapsed_seconds > 30)
-                    instance.suspended = true;
-                return;
-            default: break;
-            }
-            break;
-        }
+    if (cpu_now_ms != -1) {
+        cpu_ms = cpu_now_ms;
+        if (session_cpu_ms == -1)
+            session_cpu_ms = cpu_now_ms;
+    }
+    if (now_ms >= next_profile_ms || current != previous) {
+        sample_resources();
+        next_profile_ms = now_ms + TIMER_PROFILE_SAMPLE_MS;
     }
-    instance.tick_counter++;
-    if (instance.tick_counter == 4) {
-        instance.elapsed_seconds++;
-        instance.tick_counter = 0;
+    if (previous && previous != 'T') {
+        elapsed_ms += now_ms - since_ms;
+        if (sleep_ms > 1000)
+            std::cout << "Timer: Device slept " << sleep_ms / 1000 << " s, not counted"
+                      << std::endl;
+    }
+    since_ms = now_ms;
+    since_boot_ms = now_boot_ms;
+    long seconds = static_cast<long>(elapsed_ms / 1000);
+
+    // Idle part of the seconds returned, if a session ends
+    ended_idle = std::min(static_cast<long>(idle_ms / 1000), seconds);
+    if (current == 0 || current == 'Z') {
+        has_exited = true;
+        end_profile(seconds);
+        return seconds;
+    }
+    if (current != previous)
+        interval = TIMER_MIN_INTERVAL_MS;
+    previous = current;
+    next_check_ms = now_ms + interval;
+    interval = std::min(interval * 2, TIMER_MAX_INTERVAL_MS);
+
+    if (current == 'T' && seconds > 30) {
+        // The sub-second rest goes to the next session
+        elapsed_ms -= seconds * 1000LL;
+        idle_ms = std::min(idle_ms - ended_idle * 1000LL, elapsed_ms);
+        end_profile(seconds);
+        return -seconds;
     }
+    return 0;
 }
 
-long Timer::run()
-{
-    elapsed_seconds = 0;
-    suspended = false;
-    running = true;
+static volatile sig_atomic_t flag_stopping = 0;
 
-    struct sigaction sa;
-    sa.sa_handler = Timer::timer_handler;
-    sa.sa_flags = SA_RESTART;
-    sigaction(SIGALRM, &sa, nullptr);
+static void stop_flag_watch(int signum)
+{
+    (void) signum;
+    flag_stopping = 1;
+}
 
-    struct itimerval timer;
-    timer.it_value.tv_sec = 0;
-    timer.it_value.tv_usec = 250000;
-    timer.it_interval.tv_sec = 0;
-    timer.it_interval.tv_usec = 250000;
+// Rom launched by a flag file such as cmd_to_run.sh: its last quoted argument, else empty.
+static std::string flag_rom(const std::string& flag)
+{
+    std::ifstream     file(flag);
+    std::stringstream content;
+    content << file.rdbuf();
+    std::string command = content.str();
+    size_t      last = command.rfind('"');
+    size_t      first = last == std::string::npos || last == 0 ? std::string::npos
+                                                               : command.rfind('"', last - 1);
+    if (first == std::string::npos)
+        return "";
+    return command.substr(first + 1, last - first - 1);
+}
 
-    if (setitimer(ITIMER_REAL, &timer, nullptr) == -1) {
-        std::cerr << "Failed to set timer" << std::endl;
+/**
+ * @brief Times `rom_file` (or the rom named by the flag) while the file `flag` exists, until
+ * SIGTERM, SIGINT or SIGHUP.
+ *
+ * @details The parent directory is watched with inotify so the flag can be created, deleted,
+ * moved away or back any number of times, each presence making a session saved like those of
+ * games. The watcher only wakes on changes to that directory, with no timeout at all.
+ *
+ * @return 0 on a clean stop, 1 if the directory can not be watched.
+ */
+int Timer::watch_flag(const std::string& flag, const std::string& rom_file)
+{
+    fs::path    path(flag);
+    std::string name = path.filename().string();
+    std::string dir = path.has_parent_path() ? path.parent_path().string() : ".";
+    int         inotify_fd = inotify_init1(IN_CLOEXEC);
+    if (inotify_fd == -1 || inotify_add_watch(inotify_fd, dir.c_str(),
+                                IN_CREATE | IN_MOVED_TO | IN_CLOSE_WRITE | IN_DELETE |
+                                    IN_MOVED_FROM | IN_DELETE_SELF | IN_MOVE_SELF) == -1) {
+        std::cerr << "Timer: Could not watch " << dir << ": " << strerror(errno) << std::endl;
+        return 1;
     }
 
-    while (running && !suspended) {
-        pause();
-    }
+    // No SA_RESTART: the signal has to interrupt the blocking read
+    struct sigaction sa = {};
+    sa.sa_handler = stop_flag_watch;
+    for (int signum : {SIGTERM, SIGINT, SIGHUP})
+        sigaction(signum, &sa, nullptr);
 
-    timer.it_value.tv_sec = 0;
-    timer.it_value.tv_usec = 0;
-    timer.it_interval.tv_sec = 0;
-    timer.it_interval.tv_usec = 0;
-    setitimer(ITIMER_REAL, &timer, nullptr);
+    std::string rom;
+    long long   since_ms = -1; // while the flag exists
+    auto        begin = [&]() {
+        // Read again once written, the flag being created empty
+        std::string found = rom_file.empty() ? flag_rom(flag) : "";
+        if (!found.empty())
+            rom = found;
+        if (since_ms == -1) {
+            since_ms = clock_ms(CLOCK_MONOTONIC);
+            std::cout << "Timer: " << flag << " present, timing "
+                      << (rom.empty() ? "an unknown rom" : rom) << std::endl;
+        }
+    };
+    auto end = [&]() {
+        if (since_ms == -1)
+            return;
+        long seconds = static_cast<long>((clock_ms(CLOCK_MONOTONIC) - since_ms) / 1000);
+        since_ms = -1;
+        std::cout << "Timer: " << flag << " gone after " << seconds << " s" << std::endl;
+        if (rom.empty())
+            std::cout << "Timer: No rom found in " << flag << ", session not saved" << std::endl;
+        else if (seconds >= 30)
+            Rom::save_session(rom, seconds);
+        if (rom_file.empty())
+            rom.clear(); // named anew by the next flag
+    };
+    if (!rom_file.empty())
+        rom = rom_file;
+    if (access(flag.c_str(), F_OK) == 0)
+        begin();
+
+    alignas(struct inotify_event) char buffer[4096];
+    bool                                watching = true;
+    while (watching && !flag_stopping) {
+        ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        for (char* ptr = buffer; ptr < buffer + length;) {
+            struct inotify_event* event = reinterpret_cast<struct inotify_event*>(ptr);
+            ptr += sizeof(struct inotify_event) + event->len;
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                std::cerr << "Timer: " << dir << " is gone" << std::endl;
+                watching = false;
+            }
+            if (!event->len || name != event->name)
+                continue;
+            if (event->mask & (IN_CREATE | IN_MOVED_TO | IN_CLOSE_WRITE))
+                begin();
+            else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+                end();
+        }
+    }
 
-    return suspended ? -elapsed_seconds : elapsed_seconds;
+    end();
+    close(inotify_fd);
+    return watching ? 0 : 1;
 }
@@ -0,0 +1,332 @@
+#include "TimerCheck.h"
+
+#include "Config.h"
+#include "DB.h"
+#include "Rom.h"
+#include "Timer.h"
+#include "TimerDaemon.h"
+#include "utils.h"
+
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <poll.h>
+#include <sys/socket.h>
+
+static const char timer_check_help[] = {
+    "activities timer-check usage:\n"
+    "\t activities timer-check [-runs <n>] [-load <threads>] [-daemon]\n"};
+
+// Running and stopped phases in ms, the game killed after the last one.
+static const std::vector<std::vector<int>> timelines = {
+    {1200, 600, 900, 400, 700},               // stopped and continued
+    {2500},                                   // never stopped
+    {300, 300, 300, 300, 300, 300, 300, 300}, // brief stops, killed while stopped
+    {800, 1500},                              // long stop before the kill
+};
+
+// Timed by the daemon: two sessions long enough to be saved, with stops too short to end them,
+// the second game stopped and continued while the first, whose launch started the daemon, is.
+static const std::vector<int> daemon_timeline = {16000, 4000, 16000};
+static const std::vector<int> other_timeline = {17000, 2000, 17000};
+
+// Stops or continues `pid`, through its cgroup if any.
+static void set_stopped(pid_t pid, const std::string& cgroup, bool stopped)
+{
+    if (!cgroup.empty())
+        utils::cgroup_write(cgroup, "cgroup.freeze", stopped ? "1" : "0");
+    else
+        kill(pid, stopped ? SIGSTOP : SIGCONT);
+}
+
+static long long thread_cpu_us()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec * 1000000LL + now.tv_nsec / 1000;
+}
+
+// Voluntary and involuntary context switches of `pid`: its wakeups, near enough.
+static long long context_switches(pid_t pid)
+{
+    std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+    std::string   line;
+    long long     switches = 0;
+    while (std::getline(status, line))
+        if (line.find("ctxt_switches:") != std::string::npos)
+            switches += atoll(line.c_str() + line.find(':') + 1);
+    return switches;
+}
+
+// Forks a child idling until killed, returning once it joined `cgroup` if not empty.
+pid_t TimerCheck::spawn_game(const std::string& cgroup)
+{
+    int ready[2];
+    if (pipe(ready) == -1)
+        return -1;
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (!cgroup.empty())
+            utils::cgroup_write(cgroup, "cgroup.procs", "0");
+        close(ready[0]);
+        close(ready[1]);
+        while (true)
+            pause();
+    }
+    close(ready[1]);
+    char byte;
+    (void) !read(ready[0], &byte, 1); // returns once the child closed its end
+    close(ready[0]);
+    return pid;
+}
+
+/**
+ * @brief Follows `schedule_ms` from a thread: running, stopped, running... then kills `pid`,
+ * adding the running phases to `truth_ms`.
+ */
+std::thread TimerCheck::follow(pid_t pid, const std::string& cgroup,
+    const std::vector<int>& schedule_ms, std::atomic<long long>& truth_ms)
+{
+    long long start_ms = Timer::clock_ms(CLOCK_MONOTONIC);
+    return std::thread([=, &schedule_ms, &truth_ms]() {
+        long long since_ms = start_ms;
+        for (size_t step = 0; step < schedule_ms.size(); step++) {
+            usleep(schedule_ms[step] * 1000);
+            long long now_ms = Timer::clock_ms(CLOCK_MONOTONIC);
+            bool      running = step % 2 == 0;
+            if (running)
+                truth_ms += now_ms - since_ms;
+            since_ms = now_ms;
+            if (step + 1 == schedule_ms.size())
+                kill(pid, SIGKILL);
+            else
+                set_stopped(pid, cgroup, running);
+        }
+    });
+}
+
+/**
+ * @brief Times one child along `schedule_ms`, driving the Timer as the daemon does.
+ */
+TimerCheck::Result TimerCheck::run_once(
+    const std::string& cgroup, const std::vector<int>& schedule_ms)
+{
+    pid_t pid = spawn_game(cgroup);
+    if (pid == -1)
+        return {0, 0, 0, 0, 0};
+
+    Timer                  timer(pid);
+    std::atomic<long long> truth_ms(0);
+    long long              start_ms = Timer::clock_ms(CLOCK_MONOTONIC);
+    long long              start_cpu_us = thread_cpu_us();
+    int                    wakeups = 0;
+    timer.update();
+    std::thread schedule = follow(pid, cgroup, schedule_ms, truth_ms);
+
+    struct pollfd fds[2] = {{timer.pid_fd(), POLLIN, 0}, {timer.cgroup_events_fd(), POLLPRI, 0}};
+    while (!timer.exited()) {
+        poll(fds, 2, timer.timeout());
+        wakeups++;
+        timer.update();
+    }
+    long long cpu_us = thread_cpu_us() - start_cpu_us;
+    long long duration_ms = Timer::clock_ms(CLOCK_MONOTONIC) - start_ms;
+    schedule.join();
+    if (!cgroup.empty())
+        utils::cgroup_write(cgroup, "cgroup.freeze", "0");
+    waitpid(pid, nullptr, 0);
+    return {truth_ms, timer.elapsed(), duration_ms, wakeups, cpu_us};
+}
+
+// Runs `activities time` for `pid` from a child in `cgroup` tagged with ROM_ENV, as a launch
+// script does. Returns the pid of the client, exiting with the status of TimerDaemon::track.
+pid_t TimerCheck::spawn_client(const std::string& cgroup, const std::string& rom, pid_t pid)
+{
+    pid_t client = fork();
+    if (client == 0) {
+        if (!cgroup.empty())
+            utils::cgroup_write(cgroup, "cgroup.procs", "0");
+        setenv(ROM_ENV, rom.c_str(), 1);
+        _exit(TimerDaemon::track(rom, std::to_string(pid)));
+    }
+    return client;
+}
+
+// Compares the time saved for `rom` in DB with `truth_ms`, printing both.
+static bool check_saved(const std::string& rom, long long truth_ms, long long tolerance_ms)
+{
+    int       saved = DB::getInstance().load(utils::shorten_file_path(rom)).time;
+    long long error_ms = saved * 1000LL - truth_ms;
+    std::cout << "Daemon: " << fs::path(rom).filename().string() << " truth " << truth_ms
+              << " ms, saved " << saved << " s" << std::endl;
+    // Plus the rounding to seconds
+    return std::abs(error_ms) <= tolerance_ms + 1000;
+}
+
+/**
+ * @brief Times two games through a temporary timer daemon, laid out as on the device, and checks
+ * the sessions it saved in its DB.
+ *
+ * @details Each game has its own cgroup and its `activities time` client runs inside it, the first
+ * client starting the daemon. The second game is stopped and continued while the first is
+ * stopped: a daemon left in the cgroup of the first game would be frozen along with it, miss both
+ * transitions and count the stops as played.
+ *
+ * @return Whether both sessions were saved within the tolerance, by a daemon out of the cgroups.
+ */
+bool TimerCheck::check_daemon(const std::string& cgroup, long long tolerance_ms)
+{
+    char instance[] = "/tmp/timer-check-XXXXXX";
+    if (!mkdtemp(instance)) {
+        std::cerr << "Timer check: Could not create the daemon instance" << std::endl;
+        return false;
+    }
+    setenv(INSTANCE_ENV, instance, 1);
+    std::string rom = std::string(instance) + "/game.rom";
+    std::string other_rom = std::string(instance) + "/other.rom";
+    std::ofstream(rom).close();
+    std::ofstream(other_rom).close();
+    Config&     cfg = Config::getInstance();
+    std::string other_cgroup =
+        cgroup.empty() ? "" : utils::cgroup_create(cfg.cgroup_root, "timer-check-other");
+    if (!other_cgroup.empty())
+        utils::cgroup_write(other_cgroup, "cgroup.freeze", "0");
+
+    // The first client starts the daemon, from the cgroup of its game
+    pid_t game = spawn_game(cgroup);
+    pid_t client = spawn_client(cgroup, rom, game);
+    int   socket_fd = -1;
+    for (int tries = 0; socket_fd == -1 && tries < 50; tries++) {
+        usleep(20000);
+        socket_fd = TimerDaemon::connect_socket();
+    }
+    struct ucred credentials = {};
+    socklen_t    length = sizeof(credentials);
+    if (socket_fd == -1 ||
+        getsockopt(socket_fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == -1) {
+        std::cerr << "Timer check: The daemon did not start" << std::endl;
+        kill(game, SIGKILL);
+        waitpid(game, nullptr, 0);
+        waitpid(client, nullptr, 0);
+        utils::cgroup_remove(other_cgroup);
+        fs::remove_all(instance);
+        return false;
+    }
+    close(socket_fd);
+    usleep(50000); // for the first client to send its request
+    pid_t       daemon = credentials.pid;
+    ProcStat    before, after;
+    long long   switches = context_switches(daemon);
+    std::string daemon_cgroup = utils::get_process_cgroup(daemon);
+    utils::read_proc_stat(daemon, before);
+
+    pid_t                  other = spawn_game(other_cgroup);
+    pid_t                  other_client = spawn_client(other_cgroup, other_rom, other);
+    std::atomic<long long> truth_ms(0), other_truth_ms(0);
+    long long              start_ms = Timer::clock_ms(CLOCK_MONOTONIC);
+    std::thread            schedule = follow(game, cgroup, daemon_timeline, truth_ms);
+    std::thread other_schedule = follow(other, other_cgroup, other_timeline, other_truth_ms);
+    int         status = -1;
+    int         other_status = -1;
+    waitpid(client, &status, 0);
+    waitpid(other_client, &other_status, 0);
+    long long duration_ms = Timer::clock_ms(CLOCK_MONOTONIC) - start_ms;
+    schedule.join();
+    other_schedule.join();
+    for (const std::string& path : {cgroup, other_cgroup})
+        if (!path.empty())
+            utils::cgroup_write(path, "cgroup.freeze", "0");
+    waitpid(game, nullptr, 0);
+    waitpid(other, nullptr, 0);
+
+    switches = context_switches(daemon) - switches;
+    utils::read_proc_stat(daemon, after);
+    kill(daemon, SIGTERM);
+    for (int tries = 0; kill(daemon, 0) == 0 && tries < 100; tries++)
+        usleep(20000);
+
+    // Opened only now, on the DB of the instance
+    bool passed = check_saved(rom, truth_ms, tolerance_ms);
+    passed = check_saved(other_rom, other_truth_ms, tolerance_ms) && passed;
+    bool      tracked = status == 0 && other_status == 0;
+    bool      escaped = cgroup.empty() || cfg.cgroup_root + daemon_cgroup != cgroup;
+    long      ticks_per_second = sysconf(_SC_CLK_TCK);
+    long long cpu_ms = (after.utime + after.stime - before.utime - before.stime) * 1000 /
+                       ticks_per_second;
+    std::cout << "Daemon: cgroup " << (daemon_cgroup.empty() ? "none" : daemon_cgroup) << ", "
+              << switches * 1000.0 / duration_ms << " wakeups/s, CPU " << cpu_ms << " ms in "
+              << duration_ms / 1000 << " s" << (tracked ? "" : ", a client failed") << std::endl;
+
+    unsetenv(INSTANCE_ENV);
+    utils::cgroup_remove(other_cgroup);
+    fs::remove_all(instance);
+    return passed && tracked && escaped;
+}
+
+/**
+ * @brief Runs the check, printing each run and returning 1 if any is off by more than the
+ * tolerance: a few ms when the Timer is woken by events, its polling interval otherwise.
+ */
+int TimerCheck::run(int argc, char** argv)
+{
+    int  runs = 3;
+    int  load = 0;
+    bool daemon = false;
+    for (int i = 0; i < argc; i++) {
+        if (std::strcmp(argv[i], "-runs") == 0 && i + 1 < argc)
+            runs = atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "-load") == 0 && i + 1 < argc)
+            load = atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "-daemon") == 0)
+            daemon = true;
+        else {
+            std::cout << timer_check_help << std::endl;
+            return 1;
+        }
+    }
+
+    Config&     cfg = Config::getInstance();
+    std::string cgroup =
+        cfg.use_cgroups ? utils::cgroup_create(cfg.cgroup_root, "timer-check") : "";
+    int tolerance_ms = cgroup.empty() ? TIMER_MAX_INTERVAL_MS : 50;
+    if (!cgroup.empty())
+        utils::cgroup_write(cgroup, "cgroup.freeze", "0"); // left frozen by an interrupted check
+    std::cout << "Timer check: " << runs << " runs of " << timelines.size() << " timelines, "
+              << load << " busy threads, " << (cgroup.empty() ? "signals" : "cgroup freezer")
+              << std::endl;
+
+    std::atomic<bool>        loading(true);
+    std::vector<std::thread> busy;
+    for (int i = 0; i < load; i++)
+        busy.emplace_back([&loading]() {
+            while (loading) {
+            }
+        });
+
+    long long worst_ms = 0;
+    for (int i = 0; i < runs; i++) {
+        for (size_t t = 0; t < timelines.size(); t++) {
+            Result    result = run_once(cgroup, timelines[t]);
+            long long error_ms = result.timed_ms - result.truth_ms;
+            worst_ms = std::max(worst_ms, std::abs(error_ms));
+            std::cout << "Run " << i + 1 << "." << t + 1 << ": truth " << result.truth_ms
+                      << " ms, timed " << result.timed_ms << " ms, error " << error_ms << " ms, "
+                      << result.wakeups * 1000.0 / result.duration_ms << " wakeups/s, CPU "
+                      << result.cpu_us << " us" << std::endl;
+        }
+    }
+    bool passed = worst_ms <= tolerance_ms;
+    if (daemon && !check_daemon(cgroup, tolerance_ms))
+        passed = false;
+
+    loading = false;
+    for (std::thread& thread : busy)
+        thread.join();
+    if (!cgroup.empty())
+        utils::cgroup_remove(cgroup);
+
+    std::cout << "Timer check " << (passed ? "passed" : "failed") << ": worst error " << worst_ms
+              << " ms (tolerance " << tolerance_ms << " ms)" << std::endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,393 @@
+#include "TimerDaemon.h"
+
+#include "Config.h"
+#include "Rom.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <csignal>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+TimerDaemon::TimerDaemon()
+    : db(DB::getInstance())
+    , journal(Journal::getInstance())
+    , live(LiveSessions::getInstance())
+    , checkpoint_interval(Config::getInstance().checkpoint_minutes)
+{
+}
+
+TimerDaemon::~TimerDaemon()
+{
+    commit();
+    for (int fd : {epoll_fd, listen_fd, signal_fd})
+        if (fd != -1)
+            close(fd);
+}
+
+// Address of the daemon, or of the instance in INSTANCE_ENV if set.
+static socklen_t socket_address(struct sockaddr_un& address)
+{
+    std::string name(TIMERD_SOCKET, sizeof(TIMERD_SOCKET) - 1);
+    if (getenv(INSTANCE_ENV))
+        name += getenv(INSTANCE_ENV);
+    name.resize(std::min(name.size(), sizeof(address.sun_path)));
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, name.data(), name.size());
+    return offsetof(struct sockaddr_un, sun_path) + name.size();
+}
+
+// Connects to the daemon, -1 if it is not running.
+int TimerDaemon::connect_socket()
+{
+    struct sockaddr_un address;
+    socklen_t          length = socket_address(address);
+    int                fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd != -1 && connect(fd, reinterpret_cast<struct sockaddr*>(&address), length) == -1) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Starts the daemon detached in its own session, logging to TIMERD_LOG.
+ *
+ * @details The first `activities time` runs from the launch script of a game. The daemon leaves
+ * the cgroup and the ROM_ENV tag of that game, not to be frozen, terminated or adopted with it.
+ */
+void TimerDaemon::daemonize()
+{
+    if (!utils::daemonize(utils::instance_path(TIMERD_LOG)))
+        return;
+    unsetenv(ROM_ENV);
+    if (utils::get_process_cgroup(getpid()).compare(0, 12, "/activities/") == 0 &&
+        !utils::cgroup_leave(Config::getInstance().cgroup_root, "timerd"))
+        std::cerr << "TimerDaemon: Could not leave the cgroup of the game" << std::endl;
+    exit(getInstance().serve());
+}
+
+/**
+ * @brief Asks the daemon to time `pid` as `rom_file`, starting it if needed, and waits for the
+ * game to exit and its time to be saved.
+ *
+ * @return 0 on success, 1 if the daemon could not be reached.
+ */
+int TimerDaemon::track(const std::string& rom_file, const std::string& pid)
+{
+    int fd = connect_socket();
+    if (fd == -1) {
+        daemonize();
+        for (int tries = 0; fd == -1 && tries < 50; tries++) {
+            usleep(20000);
+            fd = connect_socket();
+        }
+    }
+    if (fd == -1) {
+        std::cerr << "Timer: Could not reach the timer daemon" << std::endl;
+        return 1;
+    }
+
+    std::string request = "track " + pid + " " + rom_file + "\n";
+    std::string reply;
+    if (send(fd, request.data(), request.size(), MSG_NOSIGNAL) ==
+        static_cast<ssize_t>(request.size())) {
+        char    buffer[64];
+        ssize_t bytes_read;
+        while ((bytes_read = read(fd, buffer, sizeof(buffer))) > 0)
+            reply.append(buffer, bytes_read);
+    }
+    close(fd);
+    return reply.compare(0, 4, "done") == 0 ? 0 : 1;
+}
+
+bool TimerDaemon::listen_socket()
+{
+    struct sockaddr_un address;
+    socklen_t          length = socket_address(address);
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (listen_fd == -1 ||
+        bind(listen_fd, reinterpret_cast<struct sockaddr*>(&address), length) == -1 ||
+        listen(listen_fd, 8) == -1) {
+        std::cerr << "TimerDaemon: Could not listen: " << strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void TimerDaemon::watch(int fd, uint32_t events)
+{
+    struct epoll_event event = {};
+    event.events = events;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1)
+        std::cerr << "TimerDaemon: Could not watch fd " << fd << ": " << strerror(errno)
+                  << std::endl;
+}
+
+void TimerDaemon::accept_client()
+{
+    int client;
+    while ((client = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK)) != -1) {
+        requests[client] = "";
+        watch(client, EPOLLIN);
+    }
+}
+
+// Reads the request line of `client`: "track <pid> <rom file>".
+void TimerDaemon::read_request(int client)
+{
+    std::string& request = requests[client];
+    char         buffer[256];
+    ssize_t      bytes_read;
+    while ((bytes_read = read(client, buffer, sizeof(buffer))) > 0)
+        request.append(buffer, bytes_read);
+
+    size_t end = request.find('\n');
+    if (end == std::string::npos) {
+        if (bytes_read == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            requests.erase(client);
+            close(client);
+        }
+        return;
+    }
+
+    std::string line = request.substr(0, end);
+    requests.erase(client);
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client, nullptr);
+
+    size_t space = line.find(' ', 6);
+    if (line.compare(0, 6, "track ") != 0 || space == std::string::npos) {
+        std::cerr << "TimerDaemon: Unknown request " << line << std::endl;
+        send(client, "error\n", 6, MSG_NOSIGNAL);
+        close(client);
+        return;
+    }
+    start_session(client, line.substr(space + 1), atoi(line.c_str() + 6));
+}
+
+void TimerDaemon::start_session(int client, const std::string& rom_file, pid_t pid)
+{
+    std::unique_ptr<Session> session(new Session{rom_file, std::unique_ptr<Timer>(new Timer(pid)),
+        client, journal.acquire(rom_file),
+        live.acquire(utils::shorten_file_path(rom_file), time(nullptr))});
+    Session* raw = session.get();
+    if (sessions.empty())
+        checkpoint_deadline = std::chrono::steady_clock::now() + checkpoint_interval;
+    sessions.push_back(std::move(session));
+    std::cout << "TimerDaemon: Tracking " << rom_file << " (PID: " << pid << ")" << std::endl;
+
+    if (raw->timer->pid_fd() != -1) {
+        session_fds[raw->timer->pid_fd()] = raw;
+        watch(raw->timer->pid_fd(), EPOLLIN);
+    }
+    if (raw->timer->cgroup_events_fd() != -1) {
+        session_fds[raw->timer->cgroup_events_fd()] = raw;
+        watch(raw->timer->cgroup_events_fd(), EPOLLPRI);
+    }
+    // Starts the accounting, ends the session at once if the game is already gone
+    update(raw);
+}
+
+void TimerDaemon::update(Session* session)
+{
+    long seconds = session->timer->update();
+    // Time saved is only published once committed, with the DB showing it
+    if (std::abs(seconds) >= 30)
+        save(session->rom_file, std::abs(seconds), *session->timer);
+    else
+        publish(session);
+    if (session->timer->exited())
+        end_session(session);
+}
+
+// Commits the time of the game that exited and releases its client.
+void TimerDaemon::end_session(Session* session)
+{
+    commit();
+    // Kept in the journal until its time is committed
+    if (in_transaction)
+        exited_slots.push_back(session->journal_slot);
+    else
+        journal.release(session->journal_slot);
+    live.release(session->live_slot);
+    std::cout << "TimerDaemon: " << session->rom_file << " exited" << std::endl;
+    if (session->client != -1) {
+        send(session->client, "done\n", 5, MSG_NOSIGNAL);
+        close(session->client);
+    }
+    session_fds.erase(session->timer->pid_fd());
+    session_fds.erase(session->timer->cgroup_events_fd());
+    sessions.erase(std::find_if(sessions.begin(), sessions.end(),
+        [session](const std::unique_ptr<Session>& entry) { return entry.get() == session; }));
+}
+
+// Saves a session with the resources it used, and its active and idle parts if tracked.
+void TimerDaemon::save(const std::string& rom_file, long seconds, const Timer& timer)
+{
+    if (!in_transaction && db.begin()) {
+        in_transaction = true;
+        commit_deadline = std::chrono::steady_clock::now() +
+                          std::chrono::milliseconds(TIMERD_COMMIT_DELAY_MS);
+    }
+    Rom::save_session(rom_file, seconds);
+    Rom::save_profile(rom_file, seconds, timer.profile());
+    if (timer.idle() != -1)
+        db.save_activity(utils::shorten_file_path(rom_file), seconds - timer.idle(), timer.idle());
+    // Without a transaction, each write was committed on its own
+    if (!in_transaction)
+        committed();
+}
+
+// Commits the pending sessions, retried after TIMERD_COMMIT_DELAY_MS while the DB is busy.
+void TimerDaemon::commit()
+{
+    if (!in_transaction)
+        return;
+    if (!db.commit()) {
+        commit_deadline = std::chrono::steady_clock::now() +
+                          std::chrono::milliseconds(TIMERD_COMMIT_DELAY_MS);
+        return;
+    }
+    in_transaction = false;
+    committed();
+}
+
+// The time just committed is no longer owed by the journal nor shown as live.
+void TimerDaemon::committed()
+{
+    for (int slot : exited_slots)
+        journal.release(slot);
+    exited_slots.clear();
+    checkpoint();
+    for (const std::unique_ptr<Session>& session : sessions)
+        publish(session.get());
+    live.committed();
+}
+
+void TimerDaemon::publish(Session* session)
+{
+    live.publish(session->live_slot, session->timer->exited() ? 0 : session->timer->elapsed(),
+        !session->timer->running());
+}
+
+/**
+ * @brief Writes the time each session has not saved yet to the journal, synced as one page.
+ */
+void TimerDaemon::checkpoint()
+{
+    if (sessions.empty())
+        return;
+    for (const std::unique_ptr<Session>& session : sessions) {
+        // An exited game has its time committed, only its slot is left to release
+        long seconds = session->timer->exited() ? 0 : session->timer->elapsed() / 1000;
+        journal.checkpoint(session->journal_slot, seconds);
+    }
+    journal.sync();
+    checkpoint_deadline = std::chrono::steady_clock::now() + checkpoint_interval;
+}
+
+// Milliseconds until `deadline`, or `timeout` if sooner.
+static int sooner(int timeout, std::chrono::steady_clock::time_point deadline)
+{
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    int deadline_timeout = std::max(0, static_cast<int>(left.count()));
+    return timeout == -1 || deadline_timeout < timeout ? deadline_timeout : timeout;
+}
+
+// Milliseconds until a session polling /proc, the pending commit or a checkpoint is due, -1 for
+// none.
+int TimerDaemon::next_timeout() const
+{
+    int timeout = -1;
+    for (const std::unique_ptr<Session>& session : sessions) {
+        int session_timeout = session->timer->timeout();
+        if (session_timeout != -1 && (timeout == -1 || session_timeout < timeout))
+            timeout = session_timeout;
+    }
+    if (in_transaction)
+        timeout = sooner(timeout, commit_deadline);
+    if (!sessions.empty() && checkpoint_interval.count() > 0)
+        timeout = sooner(timeout, checkpoint_deadline);
+    return timeout;
+}
+
+/**
+ * @brief Runs the daemon until SIGTERM, SIGINT or SIGHUP, committing pending sessions first and
+ * checkpointing those still running, recovered by the next start.
+ *
+ * @return 0 on a clean stop, 1 if the socket is not available (another daemon runs).
+ */
+int TimerDaemon::serve()
+{
+    if (!listen_socket())
+        return 1;
+    // Held until the daemon exits, the sessions left by a previous one are recovered first
+    if (journal.open(true) && journal.recover())
+        std::cout << "TimerDaemon: Recovered sessions from the journal" << std::endl;
+    live.create();
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGHUP);
+    sigprocmask(SIG_BLOCK, &mask, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+    signal_fd = signalfd(-1, &mask, SFD_CLOEXEC);
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    watch(listen_fd, EPOLLIN);
+    watch(signal_fd, EPOLLIN);
+    std::cout << "TimerDaemon: Listening (PID: " << getpid() << ")" << std::endl;
+
+    struct epoll_event events[16];
+    bool               stopping = false;
+    while (!stopping) {
+        int count = epoll_wait(epoll_fd, events, 16, next_timeout());
+        if (count == -1 && errno != EINTR) {
+            std::cerr << "TimerDaemon: epoll_wait failed: " << strerror(errno) << std::endl;
+            break;
+        }
+        for (int i = 0; i < count; i++) {
+            int fd = events[i].data.fd;
+            if (fd == signal_fd) {
+                stopping = true;
+            } else if (fd == listen_fd) {
+                accept_client();
+            } else if (requests.count(fd)) {
+                read_request(fd);
+            } else {
+                auto it = session_fds.find(fd);
+                if (it != session_fds.end())
+                    update(it->second);
+            }
+        }
+
+        // Sessions without events to wait for
+        std::vector<Session*> due;
+        for (const std::unique_ptr<Session>& session : sessions)
+            if (session->timer->timeout() == 0)
+                due.push_back(session.get());
+        for (Session* session : due)
+            update(session);
+        if (in_transaction && std::chrono::steady_clock::now() >= commit_deadline)
+            commit();
+        // Not while a commit is pending, the journal still owing the time it holds
+        if (!sessions.empty() && !in_transaction && checkpoint_interval.count() > 0 &&
+            std::chrono::steady_clock::now() >= checkpoint_deadline)
+            checkpoint();
+    }
+
+    commit();
+    if (!in_transaction)
+        checkpoint();
+    std::cout << "TimerDaemon: Stopped with " << sessions.size() << " sessions" << std::endl;
+    return 0;
+}
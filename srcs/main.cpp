@@ -1,17 +1,24 @@
 #include "Activities.h"
-#include "Timer.h"
+#include "SuspendCheck.h"
+#include "TimerCheck.h"
+#include "TimerDaemon.h"
+#include "utils.h"
 
 #include <cstring>
 #include <iostream>
 
 static const char timer_help[] = {"activities Timer usage:\n"
-                                  "\t activities time [option...]* <romFile> <processPID>\n"};
+                                  "\t activities time [option...]* <romFile> <processPID>\n"
+                                  "\t activities time <romFile> -flag <file>\n"
+                                  "\t activities -flag <file>\n"
+                                  "\t activities timerd\n"};
 
 static const char global_help[] = {"activities usage:\n"
                                    "\t activities [command] [options] ...\n"
                                    "Commands:\n"
                                    "\t- gui: Display the gui\n"
                                    "\t- time: Time a game and add it to the DB.\n"
+                                   "\t- timerd: Run the daemon timing the games.\n"
                                    "\n*use `activities [command] -h for details\n"};
 
 int main(int argc, char* argv[])
@@ -21,12 +28,26 @@ int main(int argc, char* argv[])
         return 1;
     }
 
-    if (std::strcmp(argv[1], "time") == 0) {
-        if (argc == 4) {
-            Timer::daemonize(argv[2], argv[3]);
+    if (std::strcmp(argv[1], "-flag") == 0 && argc == 3) {
+        if (utils::daemonize(FLAG_LOG))
+            return Timer::watch_flag(argv[2]);
+    } else if (std::strcmp(argv[1], "time") == 0) {
+        if (argc == 5 && std::strcmp(argv[3], "-flag") == 0) {
+            if (utils::daemonize(FLAG_LOG))
+                return Timer::watch_flag(argv[4], argv[2]);
+        } else if (argc == 4) {
+            return TimerDaemon::track(argv[2], argv[3]);
         } else {
             std::cout << timer_help << std::endl;
         }
+    } else if (std::strcmp(argv[1], "timerd") == 0) {
+        return TimerDaemon::getInstance().serve();
+    } else if (std::strcmp(argv[1], "timer-check") == 0) {
+        // Not listed: checks the timer accuracy on the device
+        return TimerCheck::run(argc - 2, argv + 2);
+    } else if (std::strcmp(argv[1], "suspend-check") == 0) {
+        // Not listed: checks which suspended games are evicted, and how
+        return SuspendCheck::run(argc - 2, argv + 2);
     } else if (std::strcmp(argv[1], "gui") == 0) {
         Activities& app = Activities::getInstance();
         // app runner will handle himself if argv[2] is a romfile or a flag.
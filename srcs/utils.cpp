@@ -1,8 +1,22 @@
 #include "utils.h"
 
+#include <algorithm>
+#include <climits>
 #include <csignal>
+#include <cstring>
+#include <dirent.h>
 #include <fstream>
 #include <iostream>
+#include <linux/input.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <unordered_set>
 
 namespace utils
 {
@@ -20,6 +34,30 @@ std::string getCurrentDateTime()
     return oss.str();
 }
 
+// Parse a "%Y-%m-%d %H:%M:%S" date as stored in DB. Returns 0 if invalid (e.g "-").
+time_t parseDateTime(const std::string& date)
+{
+    struct tm tm_info = {};
+    if (!strptime(date.c_str(), "%Y-%m-%d %H:%M:%S", &tm_info))
+        return 0;
+    tm_info.tm_isdst = -1;
+    time_t ret = mktime(&tm_info);
+    return ret == -1 ? 0 : ret;
+}
+
+// Format a date back to the DB format, "-" for 0 (never played).
+std::string formatDateTime(time_t date)
+{
+    if (date == 0)
+        return "-";
+    struct tm* tm_info = std::localtime(&date);
+    if (tm_info == nullptr)
+        return "-";
+    std::ostringstream oss;
+    oss << std::put_time(tm_info, "%Y-%m-%d %H:%M:%S");
+    return oss.str();
+}
+
 std::string sec2hhmmss(int total_seconds)
 {
     int hours = total_seconds / 3600;
@@ -88,6 +126,618 @@ void kill_process_group(pid_t pgid)
         kill(-pgid, SIGTERM);
 }
 
+/**
+ * @brief Reads the state, process group and CPU times of `pid` from /proc/<pid>/stat.
+ *
+ * @return false if the process does not exist anymore.
+ */
+bool read_proc_stat(pid_t pid, ProcStat& stat)
+{
+    std::ifstream file("/proc/" + std::to_string(pid) + "/stat");
+    std::string   line;
+    if (!std::getline(file, line))
+        return false;
+    // comm may contain spaces, fields are counted from its closing parenthesis
+    size_t comm_end = line.rfind(')');
+    if (comm_end == std::string::npos)
+        return false;
+    std::istringstream fields(line.substr(comm_end + 2));
+    std::string        skip;
+    pid_t              ppid;
+    fields >> stat.state >> ppid >> stat.pgrp;
+    for (int i = 0; i < 6; i++) // session, tty_nr, tpgid, flags, minflt, cminflt
+        fields >> skip;
+    fields >> stat.majflt >> skip >> stat.utime >> stat.stime;
+    return !fields.fail();
+}
+
+// Pids of every process of the group `pgid`.
+std::vector<pid_t> get_process_group_pids(pid_t pgid)
+{
+    std::vector<pid_t> pids;
+    DIR*               proc = opendir("/proc");
+    if (!proc)
+        return pids;
+    while (struct dirent* entry = readdir(proc)) {
+        pid_t    pid = atoi(entry->d_name);
+        ProcStat stat;
+        if (pid > 0 && read_proc_stat(pid, stat) && stat.pgrp == pgid)
+            pids.push_back(pid);
+    }
+    closedir(proc);
+    return pids;
+}
+
+// CPU time (user + system, in clock ticks) used so far by the group `pgid`.
+unsigned long get_process_group_cpu_ticks(pid_t pgid)
+{
+    unsigned long ticks = 0;
+    for (pid_t pid : get_process_group_pids(pgid)) {
+        ProcStat stat;
+        if (read_proc_stat(pid, stat))
+            ticks += stat.utime + stat.stime;
+    }
+    return ticks;
+}
+
+// Major page faults (pages read back from disk or swap) of the group `pgid`.
+unsigned long get_process_group_majflt(pid_t pgid)
+{
+    unsigned long majflt = 0;
+    for (pid_t pid : get_process_group_pids(pgid)) {
+        ProcStat stat;
+        if (read_proc_stat(pid, stat))
+            majflt += stat.majflt;
+    }
+    return majflt;
+}
+
+// Bytes the group `pgid` caused to be written to storage, its files being saved.
+unsigned long long get_process_group_write_bytes(pid_t pgid)
+{
+    unsigned long long bytes = 0;
+    for (pid_t pid : get_process_group_pids(pgid)) {
+        std::ifstream io("/proc/" + std::to_string(pid) + "/io");
+        std::string   line;
+        while (std::getline(io, line)) {
+            if (line.compare(0, 12, "write_bytes:") == 0) {
+                bytes += std::stoull(line.substr(12));
+                break;
+            }
+        }
+    }
+    return bytes;
+}
+
+static bool is_av_device(const std::string& target)
+{
+    static const char* devices[] = {"/dev/fb", "/dev/dri/", "/dev/mali", "/dev/snd/", "/dev/dsp"};
+    for (const char* device : devices)
+        if (target.compare(0, strlen(device), device) == 0)
+            return true;
+    return false;
+}
+
+// "<fd>:<target>" of the display and audio devices opened by `pid`.
+static std::unordered_set<std::string> get_av_fds(pid_t pid)
+{
+    std::unordered_set<std::string> fds;
+    std::string fd_dir = "/proc/" + (pid ? std::to_string(pid) : "self") + "/fd";
+    DIR*        dir = opendir(fd_dir.c_str());
+    if (!dir)
+        return fds;
+    char target[256];
+    while (struct dirent* entry = readdir(dir)) {
+        ssize_t len =
+            readlink((fd_dir + "/" + entry->d_name).c_str(), target, sizeof(target) - 1);
+        if (len <= 0)
+            continue;
+        target[len] = '\0';
+        if (is_av_device(target))
+            fds.insert(std::string(entry->d_name) + ":" + target);
+    }
+    closedir(dir);
+    return fds;
+}
+
+/**
+ * @brief Tells whether a process of the group `pgid` opened a display or audio device.
+ *
+ * @details Devices inherited from this process (same fd number and target) are ignored, so only
+ * devices opened by the game itself count. A game opening them has usually finished loading.
+ */
+bool process_group_uses_av_device(pid_t pgid)
+{
+    std::unordered_set<std::string> inherited = get_av_fds(0);
+    for (pid_t pid : get_process_group_pids(pgid)) {
+        for (const std::string& fd : get_av_fds(pid))
+            if (inherited.find(fd) == inherited.end())
+                return true;
+    }
+    return false;
+}
+
+// Resident memory (VmRSS, in bytes) of the group `pgid`.
+size_t get_process_group_rss(pid_t pgid)
+{
+    size_t rss = 0;
+    for (pid_t pid : get_process_group_pids(pgid)) {
+        std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+        std::string   line;
+        while (std::getline(status, line)) {
+            if (line.compare(0, 6, "VmRSS:") == 0) {
+                rss += std::stoul(line.substr(6)) * 1024;
+                break;
+            }
+        }
+    }
+    return rss;
+}
+
+/**
+ * @brief Tells whether a process of the group `pgid` holds a UDP socket bound on `port`.
+ *
+ * @details The socket inodes are looked up in /proc/net/udp and /proc/net/udp6, as the port may be
+ * bound on an IPv6 or dual-stack socket, then among the `socket:[inode]` fds of the group.
+ *
+ * @param family Set to the address family of the socket found, AF_INET or AF_INET6.
+ */
+bool process_group_owns_udp_port(pid_t pgid, int port, int* family)
+{
+    std::unordered_map<std::string, int> sockets; // "socket:[inode]" to family
+    for (int table_family : {AF_INET, AF_INET6}) {
+        std::ifstream udp(table_family == AF_INET ? "/proc/net/udp" : "/proc/net/udp6");
+        std::string   line;
+        std::getline(udp, line); // header
+        while (std::getline(udp, line)) {
+            std::istringstream fields(line);
+            std::string        slot, local, skip;
+            unsigned long      inode = 0;
+            fields >> slot >> local;
+            for (int i = 0; i < 7; i++) // rem_address, st, queues, tr, retrnsmt, uid, timeout
+                fields >> skip;
+            fields >> inode;
+            size_t sep = local.find(':');
+            if (sep != std::string::npos && std::stoi(local.substr(sep + 1), nullptr, 16) == port)
+                sockets["socket:[" + std::to_string(inode) + "]"] = table_family;
+        }
+    }
+    if (sockets.empty())
+        return false;
+
+    char target[64];
+    for (pid_t pid : get_process_group_pids(pgid)) {
+        std::string fd_dir = "/proc/" + std::to_string(pid) + "/fd";
+        DIR*        dir = opendir(fd_dir.c_str());
+        if (!dir)
+            continue;
+        auto found = sockets.end();
+        while (struct dirent* entry = readdir(dir)) {
+            ssize_t len =
+                readlink((fd_dir + "/" + entry->d_name).c_str(), target, sizeof(target) - 1);
+            if (len > 0 && (found = sockets.find(std::string(target, len))) != sockets.end())
+                break;
+        }
+        closedir(dir);
+        if (found != sockets.end()) {
+            if (family)
+                *family = found->second;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Sends `command` as a single datagram to the loopback address of `family`, on `port`.
+bool send_udp_command(int port, const std::string& command, int family)
+{
+    int sock = ::socket(family, SOCK_DGRAM, 0);
+    if (sock == -1) {
+        std::cerr << "Failed to create socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+    struct sockaddr_storage addr = {};
+    socklen_t               length;
+    if (family == AF_INET6) {
+        struct sockaddr_in6* addr6 = reinterpret_cast<struct sockaddr_in6*>(&addr);
+        addr6->sin6_family = AF_INET6;
+        addr6->sin6_port = htons(port);
+        addr6->sin6_addr = in6addr_loopback;
+        length = sizeof(*addr6);
+    } else {
+        struct sockaddr_in* addr4 = reinterpret_cast<struct sockaddr_in*>(&addr);
+        addr4->sin_family = AF_INET;
+        addr4->sin_port = htons(port);
+        addr4->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        length = sizeof(*addr4);
+    }
+    ssize_t sent = sendto(sock, command.c_str(), command.size(), 0,
+        reinterpret_cast<struct sockaddr*>(&addr), length);
+    close(sock);
+    return sent == static_cast<ssize_t>(command.size());
+}
+
+#ifndef __NR_pidfd_open
+#    define __NR_pidfd_open 434
+#endif
+#ifndef __NR_process_madvise
+#    define __NR_process_madvise 440
+#endif
+#ifndef MADV_PAGEOUT
+#    define MADV_PAGEOUT 21
+#endif
+
+// Private anonymous mappings (heap, stack, anonymous mmaps) of `pid`.
+static std::vector<struct iovec> get_anonymous_ranges(pid_t pid)
+{
+    std::vector<struct iovec> ranges;
+    std::ifstream             maps("/proc/" + std::to_string(pid) + "/maps");
+    std::string               line;
+    while (std::getline(maps, line)) {
+        std::istringstream fields(line);
+        std::string        range, perms, offset, dev, path;
+        unsigned long      inode;
+        fields >> range >> perms >> offset >> dev >> inode >> path;
+        if (inode != 0 || perms.size() < 4 || perms[0] != 'r' || perms[3] != 'p')
+            continue;
+        if (!path.empty() && path != "[heap]" && path.compare(0, 6, "[stack") != 0 &&
+            path.compare(0, 6, "[anon:") != 0)
+            continue;
+        size_t        sep = range.find('-');
+        unsigned long start = std::stoul(range.substr(0, sep), nullptr, 16);
+        unsigned long end = std::stoul(range.substr(sep + 1), nullptr, 16);
+        ranges.push_back({reinterpret_cast<void*>(start), end - start});
+    }
+    return ranges;
+}
+
+// Pages out the anonymous memory of `pid` with process_madvise(MADV_PAGEOUT) (Linux 5.10+).
+static bool page_out_process(pid_t pid)
+{
+    int pidfd = pidfd_open(pid);
+    if (pidfd == -1)
+        return false;
+    std::vector<struct iovec> ranges = get_anonymous_ranges(pid);
+    bool                      success = true;
+    for (size_t i = 0; i < ranges.size() && success; i += IOV_MAX) {
+        size_t count = std::min(ranges.size() - i, static_cast<size_t>(IOV_MAX));
+        success = syscall(__NR_process_madvise, pidfd, &ranges[i], count, MADV_PAGEOUT, 0) != -1;
+    }
+    close(pidfd);
+    return success;
+}
+
+/**
+ * @brief Asks the kernel to swap out (to zram or swap) the anonymous memory of a stopped group.
+ *
+ * @details Uses process_madvise(MADV_PAGEOUT) and falls back on the /proc/<pid>/reclaim interface
+ * of older vendor kernels.
+ *
+ * @return false if neither is supported for one of the processes.
+ */
+bool page_out_process_group(pid_t pgid)
+{
+    bool success = true;
+    for (pid_t pid : get_process_group_pids(pgid)) {
+        if (page_out_process(pid))
+            continue;
+        std::ofstream reclaim("/proc/" + std::to_string(pid) + "/reclaim");
+        reclaim << "anon" << std::flush;
+        if (!reclaim.good()) {
+            std::cerr << "Could not page out " << pid << ": " << strerror(errno) << std::endl;
+            success = false;
+        }
+    }
+    return success;
+}
+
+/**
+ * @brief Finds the process groups with a process carrying the environment variable `name`.
+ *
+ * @return The value of the variable for each process group id.
+ */
+std::unordered_map<pid_t, std::string> find_process_groups_by_env(const std::string& name)
+{
+    std::unordered_map<pid_t, std::string> groups;
+    std::string                            prefix = name + "=";
+    DIR*                                   proc = opendir("/proc");
+    if (!proc)
+        return groups;
+    while (struct dirent* entry = readdir(proc)) {
+        pid_t    pid = atoi(entry->d_name);
+        ProcStat stat;
+        if (pid <= 0 || !read_proc_stat(pid, stat) || groups.count(stat.pgrp))
+            continue;
+        std::ifstream environ("/proc/" + std::to_string(pid) + "/environ");
+        std::string   variable;
+        while (std::getline(environ, variable, '\0')) {
+            if (variable.compare(0, prefix.size(), prefix) == 0) {
+                groups[stat.pgrp] = variable.substr(prefix.size());
+                break;
+            }
+        }
+    }
+    closedir(proc);
+    return groups;
+}
+
+// Command name of `pid` (/proc/<pid>/comm).
+std::string get_process_name(pid_t pid)
+{
+    std::ifstream comm("/proc/" + std::to_string(pid) + "/comm");
+    std::string   name;
+    std::getline(comm, name);
+    return name;
+}
+
+// Thread ids of `pid`. Nice value, affinity and policy are per thread on Linux.
+static std::vector<pid_t> get_threads(pid_t pid)
+{
+    std::vector<pid_t> threads;
+    std::string        task_dir = "/proc/" + std::to_string(pid) + "/task";
+    DIR*               dir = opendir(task_dir.c_str());
+    if (!dir)
+        return threads;
+    while (struct dirent* entry = readdir(dir)) {
+        pid_t tid = atoi(entry->d_name);
+        if (tid > 0)
+            threads.push_back(tid);
+    }
+    closedir(dir);
+    return threads;
+}
+
+void set_process_nice(pid_t pid, int nice)
+{
+    for (pid_t tid : get_threads(pid))
+        setpriority(PRIO_PROCESS, tid, nice);
+}
+
+void set_process_affinity(pid_t pid, const cpu_set_t& cpus)
+{
+    for (pid_t tid : get_threads(pid))
+        sched_setaffinity(tid, sizeof(cpus), &cpus);
+}
+
+// Moves `pid` to SCHED_BATCH. Its future children go back to SCHED_OTHER.
+void set_process_batch(pid_t pid)
+{
+    struct sched_param param = {};
+    for (pid_t tid : get_threads(pid))
+        sched_setscheduler(tid, SCHED_BATCH | SCHED_RESET_ON_FORK, &param);
+}
+
+// Marks every fd above stderr close-on-exec, so launched programs do not inherit them.
+void set_cloexec_on_all_fds()
+{
+    DIR* dir = opendir("/proc/self/fd");
+    if (!dir)
+        return;
+    int dir_fd = dirfd(dir);
+    while (struct dirent* entry = readdir(dir)) {
+        int fd = atoi(entry->d_name);
+        if (fd > STDERR_FILENO && fd != dir_fd)
+            fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+    }
+    closedir(dir);
+}
+
+static bool test_bit(const unsigned long* bits, int bit)
+{
+    return bits[bit / (8 * sizeof(long))] & (1UL << (bit % (8 * sizeof(long))));
+}
+
+/**
+ * @brief Opens (read only, non blocking) the /dev/input/event* device named `name`, or else the
+ * first one looking like a gamepad.
+ *
+ * @return The fd, -1 if none.
+ */
+int open_gamepad_evdev(const std::string& name)
+{
+    int fallback = -1;
+    for (int i = 0; i < 32; i++) {
+        std::string path = "/dev/input/event" + std::to_string(i);
+        int         fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd == -1)
+            continue;
+        char          device_name[256] = "";
+        unsigned long keys[KEY_CNT / (8 * sizeof(long)) + 1] = {};
+        ioctl(fd, EVIOCGNAME(sizeof(device_name)), device_name);
+        ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keys)), keys);
+        if (!name.empty() && name == device_name) {
+            if (fallback != -1)
+                close(fallback);
+            return fd;
+        }
+        if (fallback == -1 && (test_bit(keys, BTN_SOUTH) || test_bit(keys, BTN_JOYSTICK)))
+            fallback = fd;
+        else
+            close(fd);
+    }
+    return fallback;
+}
+
+// Key codes of the buttons of an evdev device, indexed like SDL joystick buttons.
+std::vector<int> get_evdev_buttons(int fd)
+{
+    std::vector<int> buttons;
+    unsigned long    keys[KEY_CNT / (8 * sizeof(long)) + 1] = {};
+    if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keys)), keys) < 0)
+        return buttons;
+    for (int code = BTN_JOYSTICK; code < KEY_MAX; code++)
+        if (test_bit(keys, code))
+            buttons.push_back(code);
+    for (int code = 0; code < BTN_JOYSTICK; code++)
+        if (test_bit(keys, code))
+            buttons.push_back(code);
+    return buttons;
+}
+
+// A fd becoming readable when `pid` exits (Linux 5.3+), -1 if not supported.
+int pidfd_open(pid_t pid)
+{
+    return syscall(__NR_pidfd_open, pid, 0);
+}
+
+/**
+ * @brief Detaches a daemon from the calling process: new session, stdout and stderr appended to
+ * `log_file`, stdin on /dev/null.
+ *
+ * @return true in the daemon, false in the caller once the daemon is started.
+ */
+bool daemonize(const std::string& log_file)
+{
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::cerr << "Failed to fork" << std::endl;
+        return false;
+    }
+    if (pid > 0) {
+        waitpid(pid, nullptr, 0);
+        return false;
+    }
+
+    setsid();
+    pid = fork();
+    if (pid != 0)
+        _exit(pid < 0);
+
+    int logfile = open(log_file.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (logfile != -1) {
+        dup2(logfile, STDOUT_FILENO);
+        dup2(logfile, STDERR_FILENO);
+        close(logfile);
+    }
+    int devnull = open("/dev/null", O_RDWR);
+    if (devnull != -1) {
+        dup2(devnull, STDIN_FILENO);
+        close(devnull);
+    }
+    return true;
+}
+
+// `path`, or its file in the INSTANCE_ENV directory when set.
+std::string instance_path(const std::string& path)
+{
+    const char* instance = getenv(INSTANCE_ENV);
+    if (!instance || !*instance)
+        return path;
+    return std::string(instance) + "/" + fs::path(path).filename().string();
+}
+
+// Parses a cpu list such as "2-3" or "0,2". Returns false if empty or invalid.
+bool parse_cpu_list(const std::string& list, cpu_set_t& cpus)
+{
+    CPU_ZERO(&cpus);
+    std::istringstream ranges(list);
+    std::string        range;
+    while (std::getline(ranges, range, ',')) {
+        int first, last;
+        int fields = sscanf(range.c_str(), "%d-%d", &first, &last);
+        if (fields < 1 || first < 0)
+            return false;
+        if (fields == 1)
+            last = first;
+        for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++)
+            CPU_SET(cpu, &cpus);
+    }
+    return CPU_COUNT(&cpus) > 0;
+}
+
+// cgroup v2 path of `pid`, relative to the cgroup root. Empty if not found.
+std::string get_process_cgroup(pid_t pid)
+{
+    std::ifstream cgroup_file("/proc/" + std::to_string(pid) + "/cgroup");
+    std::string   line;
+    while (std::getline(cgroup_file, line)) {
+        if (line.compare(0, 3, "0::") == 0)
+            return line.substr(3);
+    }
+    return "";
+}
+
+/**
+ * @brief Creates the cgroup `root`/activities/`name` for a game, enabling the memory and cpu
+ * controllers on the way when possible.
+ *
+ * @return Its path, or an empty string if `root` is not a cgroup v2 hierarchy with the freezer
+ * (Linux 5.2+).
+ */
+std::string cgroup_create(const std::string& root, const std::string& name)
+{
+    struct stat st;
+    if (stat((root + "/cgroup.controllers").c_str(), &st) != 0)
+        return "";
+    std::string parent = root + "/activities";
+    if (mkdir(parent.c_str(), 0755) != 0 && errno != EEXIST)
+        return "";
+    for (const char* controller : {"+memory", "+cpu"}) {
+        cgroup_write(root, "cgroup.subtree_control", controller);
+        cgroup_write(parent, "cgroup.subtree_control", controller);
+    }
+
+    std::string cgroup = parent + "/" + name;
+    if (mkdir(cgroup.c_str(), 0755) != 0 && errno != EEXIST)
+        return "";
+    if (stat((cgroup + "/cgroup.freeze").c_str(), &st) != 0) {
+        rmdir(cgroup.c_str());
+        return "";
+    }
+    return cgroup;
+}
+
+// Writes `value` to an interface file of `cgroup`.
+bool cgroup_write(const std::string& cgroup, const std::string& file, const char* value)
+{
+    int fd = open((cgroup + "/" + file).c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd == -1)
+        return false;
+    bool success = write(fd, value, strlen(value)) != -1;
+    close(fd);
+    return success;
+}
+
+/**
+ * @brief Moves the calling process to the cgroup `root`/activities/`name`, or to `root` if it can
+ * not be created, out of the cgroup of the game it was started from.
+ */
+bool cgroup_leave(const std::string& root, const std::string& name)
+{
+    std::string cgroup = cgroup_create(root, name);
+    return cgroup_write(cgroup.empty() ? root : cgroup, "cgroup.procs", "0");
+}
+
+// Content of an interface file of `cgroup`, empty if it can not be read.
+std::string cgroup_read(const std::string& cgroup, const std::string& file)
+{
+    std::ifstream     in(cgroup + "/" + file);
+    std::stringstream content;
+    content << in.rdbuf();
+    return content.str();
+}
+
+// Whether some process is in `cgroup`, from the "populated 0|1" line of its cgroup.events.
+bool cgroup_populated(const std::string& cgroup)
+{
+    return cgroup_read(cgroup, "cgroup.events").find("populated 1") != std::string::npos;
+}
+
+// Sends `signum` to every process of `cgroup`, even those that left the game process group.
+void cgroup_signal(const std::string& cgroup, int signum)
+{
+    std::ifstream procs(cgroup + "/cgroup.procs");
+    pid_t         pid;
+    while (procs >> pid)
+        kill(pid, signum);
+}
+
+// Removes `cgroup`, which fails with EBUSY until all its processes exited. True once it is gone.
+bool cgroup_remove(const std::string& cgroup)
+{
+    return cgroup.empty() || rmdir(cgroup.c_str()) == 0 || errno == ENOENT;
+}
+
 // Returns true if /tmp/trimui_inputd/ra_hotkey exists
 bool ra_hotkey_exists()
 {